@@ -0,0 +1,327 @@
+// eclipse-luac: compiles Eclipse script trees ahead of time.
+//
+// Produces either one .out file per script, loaded by the server like any script,
+// or a single script pack for Eclipse.ScriptPack. Scripts are named and ordered the
+// way the server discovers them, so a pack behaves like the directory it was built from.
+
+#include "LuaAbi.hpp"
+#include "ScriptPackFormat.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    struct Options
+    {
+        std::vector<std::string> inputs;
+        std::string outputDirectory;
+        std::string packPath;
+        bool strip = false;
+        bool quiet = false;
+    };
+
+    struct Script
+    {
+        std::string path;
+        fs::path root;
+    };
+
+    void PrintUsage()
+    {
+        std::cerr <<
+            "Usage: eclipse-luac [options] <script or directory>...\n"
+            "  -o <dir>   write one .out per script under <dir>, mirroring the input tree\n"
+            "  -p <file>  write a script pack for Eclipse.ScriptPack instead\n"
+            "  -s         strip debug information (LuaJIT and Lua 5.3+)\n"
+            "  -q         only report errors and the summary\n"
+            "MoonScript sources need the moonscript module on LUA_PATH.\n"
+            "Run from the worldserver directory with the same paths as Eclipse.ScriptPath,\n"
+            "script names are kept as given and used as chunk names by the server.\n";
+    }
+
+    bool ParseOptions(int argc, char** argv, Options& options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if ((arg == "-o" || arg == "-p") && i + 1 < argc)
+                (arg == "-o" ? options.outputDirectory : options.packPath) = argv[++i];
+            else if (arg == "-s")
+                options.strip = true;
+            else if (arg == "-q")
+                options.quiet = true;
+            else if (!arg.empty() && arg[0] == '-')
+                return false;
+            else
+                options.inputs.emplace_back(std::move(arg));
+        }
+
+        // Exactly one of -o and -p
+        return !options.inputs.empty() && (options.outputDirectory.empty() != options.packPath.empty());
+    }
+
+    fs::path NormalizePath(const fs::path& path)
+    {
+        // Absolute first, weakly_canonical keeps a missing relative path relative
+        std::error_code ec;
+        fs::path normalized = fs::weakly_canonical(fs::absolute(path), ec);
+        if (ec)
+            normalized = fs::absolute(path).lexically_normal();
+
+        // "dir/" and "dir" must compare equal
+        return normalized.has_filename() ? normalized : normalized.parent_path();
+    }
+
+    // True when path is base or lies below it
+    bool IsWithin(const fs::path& path, const fs::path& base)
+    {
+        return std::mismatch(base.begin(), base.end(), path.begin(), path.end()).first == base.end();
+    }
+
+    // Writing next to or under the sources would make the server load every script twice
+    bool CheckOutputDirectory(const Options& options)
+    {
+        fs::path output = NormalizePath(options.outputDirectory);
+        for (const auto& input : options.inputs)
+        {
+            fs::path root = fs::is_regular_file(input) ? fs::path(input).parent_path() : fs::path(input);
+            if (IsWithin(output, NormalizePath(root.empty() ? "." : root)))
+            {
+                std::cerr << "error: output directory " << options.outputDirectory << " is inside input " << input << "\n";
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Same extensions as ScriptLoader::IsValidScriptExtension, .out files are recompiled from their bytecode
+    bool IsSourceExtension(const fs::path& path)
+    {
+        auto extension = path.extension();
+        return extension == ".lua" || extension == ".moon" || extension == ".ext" || extension == ".out";
+    }
+
+    // Same order as ScriptLoader::DiscoverScripts: sorted full paths, per input
+    std::vector<Script> DiscoverScripts(const std::vector<std::string>& inputs)
+    {
+        std::vector<Script> scripts;
+
+        for (const auto& input : inputs)
+        {
+            fs::path root(input);
+            if (fs::is_regular_file(root))
+            {
+                scripts.push_back({ root.string(), root.parent_path() });
+                continue;
+            }
+
+            if (!fs::is_directory(root))
+            {
+                std::cerr << "warning: " << input << " not found\n";
+                continue;
+            }
+
+            std::vector<Script> found;
+            for (const auto& entry : fs::recursive_directory_iterator(root))
+            {
+                if (entry.is_regular_file() && IsSourceExtension(entry.path()))
+                    found.push_back({ entry.path().string(), root });
+            }
+
+            std::sort(found.begin(), found.end(), [](const Script& a, const Script& b) { return a.path < b.path; });
+            std::move(found.begin(), found.end(), std::back_inserter(scripts));
+        }
+
+        return scripts;
+    }
+
+    bool ReadFile(const std::string& filePath, std::string& content)
+    {
+        std::ifstream file(filePath, std::ios::binary);
+        if (!file.is_open())
+            return false;
+
+        content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    bool TranslateMoonScript(lua_State* L, const std::string& source, std::string& luaSource, std::string& error)
+    {
+        lua_getglobal(L, "require");
+        lua_pushstring(L, "moonscript.base");
+        if (lua_pcall(L, 1, 1, 0) != 0)
+        {
+            error = lua_tostring(L, -1);
+            lua_pop(L, 1);
+            return false;
+        }
+
+        lua_getfield(L, -1, "to_lua");
+        lua_remove(L, -2);
+        lua_pushlstring(L, source.data(), source.size());
+        if (lua_pcall(L, 1, 2, 0) != 0)
+        {
+            error = lua_tostring(L, -1);
+            lua_pop(L, 1);
+            return false;
+        }
+
+        bool translated = lua_isstring(L, -2) != 0;
+        if (translated)
+            luaSource = lua_tostring(L, -2);
+        else
+            error = lua_isstring(L, -1) ? lua_tostring(L, -1) : "MoonScript translation failed";
+
+        lua_pop(L, 2);
+        return translated;
+    }
+
+    // Goes through string.dump, which also accepts bytecode input. Its strip flag is only
+    // honoured by LuaJIT and Lua 5.3+, older versions always keep debug information.
+    bool Compile(lua_State* L, const std::string& source, const std::string& chunkName, bool strip, std::vector<char>& bytecode, std::string& error)
+    {
+        if (luaL_loadbuffer(L, source.data(), source.size(), chunkName.c_str()) != 0)
+        {
+            error = lua_tostring(L, -1);
+            lua_pop(L, 1);
+            return false;
+        }
+
+        lua_getglobal(L, "string");
+        lua_getfield(L, -1, "dump");
+        lua_remove(L, -2);
+        lua_insert(L, -2);
+        lua_pushboolean(L, strip);
+        if (lua_pcall(L, 2, 1, 0) != 0)
+        {
+            error = lua_tostring(L, -1);
+            lua_pop(L, 1);
+            return false;
+        }
+
+        size_t size = 0;
+        const char* data = lua_tolstring(L, -1, &size);
+        bytecode.assign(data, data + size);
+        lua_pop(L, 1);
+        return true;
+    }
+
+    bool WriteOutFile(const Options& options, const Script& script, const std::vector<char>& bytecode)
+    {
+        fs::path target = fs::path(options.outputDirectory) / fs::path(script.path).lexically_relative(script.root);
+        target.replace_extension(".out");
+
+        std::error_code ec;
+        fs::create_directories(target.parent_path(), ec);
+
+        std::ofstream file(target, std::ios::binary | std::ios::trunc);
+        file.write(bytecode.data(), bytecode.size());
+        return static_cast<bool>(file);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    if (!options.outputDirectory.empty() && !CheckOutputDirectory(options))
+        return 2;
+
+#if LUA_VERSION_NUM < 503 && !defined(LUAJIT_VERSION_NUM)
+    if (options.strip)
+        std::cerr << "warning: " << LUA_RELEASE << " cannot strip debug information, -s is ignored\n";
+#endif
+
+    auto scripts = DiscoverScripts(options.inputs);
+    if (scripts.empty())
+    {
+        std::cerr << "error: no scripts found\n";
+        return 1;
+    }
+
+    lua_State* L = luaL_newstate();
+    luaL_openlibs(L);
+
+    std::vector<Eclipse::ScriptPackFormat::ChunkSource> chunks;
+    size_t failed = 0;
+    size_t totalSize = 0;
+    auto totalStart = std::chrono::steady_clock::now();
+
+    for (const auto& script : scripts)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        std::string source;
+        std::string error;
+        std::vector<char> bytecode;
+
+        bool success = ReadFile(script.path, source);
+        if (!success)
+            error = "cannot read file";
+
+        if (success && fs::path(script.path).extension() == ".moon")
+        {
+            std::string moonSource = std::move(source);
+            success = TranslateMoonScript(L, moonSource, source, error);
+        }
+
+        // Chunk names match what the server passes for the same file
+        success = success && Compile(L, source, script.path, options.strip, bytecode, error);
+
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        if (!success)
+        {
+            std::cerr << "error: " << script.path << ": " << error << "\n";
+            ++failed;
+            continue;
+        }
+
+        if (!options.quiet)
+            std::printf("%10zu B %9.2f ms  %s\n", bytecode.size(), elapsed, script.path.c_str());
+
+        totalSize += bytecode.size();
+
+        if (!options.packPath.empty())
+            chunks.push_back({ script.path, std::move(bytecode) });
+        else if (!WriteOutFile(options, script, bytecode))
+        {
+            std::cerr << "error: " << script.path << ": cannot write output\n";
+            ++failed;
+        }
+    }
+
+    lua_close(L);
+
+    double totalElapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - totalStart).count();
+    std::printf("%zu scripts, %zu failed, %zu bytes of bytecode in %.2f ms (%s)\n",
+        scripts.size(), failed, totalSize, totalElapsed, Eclipse::GetLuaAbiTag().c_str());
+
+    // A pack with missing scripts would silently change server behaviour
+    if (failed)
+        return 1;
+
+    if (!options.packPath.empty() && !Eclipse::ScriptPackFormat::Write(options.packPath, chunks, Eclipse::GetLuaAbiTag()))
+    {
+        std::cerr << "error: cannot write script pack " << options.packPath << "\n";
+        return 1;
+    }
+
+    return 0;
+}
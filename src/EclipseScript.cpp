@@ -8,6 +8,10 @@
 #include "Events.hpp"
 #include "EclipseConfig.hpp"
 #include "EclipseLogger.hpp"
+#include "MessageManager.hpp"
+#include "CompilerPool.hpp"
+#include "ScriptWatcher.hpp"
+#include "ScriptLoader.hpp"
 #include <any>
 #include <optional>
 
@@ -17,7 +21,8 @@ public:
     Eclipse_WorldScript() : WorldScript("Eclipse_WorldScript", {
         WORLDHOOK_ON_BEFORE_CONFIG_LOAD,
         WORLDHOOK_ON_SHUTDOWN,
-        WORLDHOOK_ON_STARTUP
+        WORLDHOOK_ON_STARTUP,
+        WORLDHOOK_ON_UPDATE
      }) { }
 
     void OnBeforeConfigLoad(bool reload) override
@@ -29,7 +34,25 @@ public:
             Eclipse::EclipseLogger::GetInstance().LogEngineStartup();
             Eclipse::EclipseLogger::GetInstance().LogInfo("Searching scripts from `lua_scripts`");
 
-            // Create global state (-1) early - required for other states
+            // Compiling needs no world data, it runs while the core loads the database and DBC stores.
+            // The global state is created at OnStartup, or earlier if an event needs it first
+            if (Eclipse::EclipseConfig::GetInstance().GetScriptPack().empty())
+                Eclipse::ScriptLoader::StartPrecompile("lua_scripts");
+        }
+    }
+
+    void OnShutdown() override
+    {
+        Eclipse::ScriptWatcher::GetInstance().Stop();
+        Eclipse::CompilerPool::GetInstance().Shutdown();
+        Eclipse::EclipseLogger::GetInstance().LogEngineShutdown();
+    }
+
+    void OnStartup() override
+    {
+        if (Eclipse::EclipseConfig::GetInstance().IsEclipseEnabled())
+        {
+            // Global state (-1) is required for other states, it executes the precompiled scripts
             auto* globalEngine = Eclipse::MapStateManager::GetInstance().GetGlobalState();
 
             if (globalEngine)
@@ -40,19 +63,19 @@ public:
             {
                 Eclipse::EclipseLogger::GetInstance().LogError("Eclipse Global Lua Engine failed to initialize");
             }
-        }
-    }
 
-    void OnShutdown() override
-    {
-        Eclipse::EclipseLogger::GetInstance().LogEngineShutdown();
+            Eclipse::EclipseLogger::GetInstance().LogTotalInitializationTime();
+
+            if (globalEngine && Eclipse::EclipseConfig::GetInstance().IsScriptWatcherEnabled() && Eclipse::EclipseConfig::GetInstance().GetScriptPack().empty())
+                Eclipse::ScriptWatcher::GetInstance().Start(globalEngine->GetScriptsDirectory());
+        }
     }
 
-    void OnStartup() override
+    void OnUpdate(uint32 diff) override
     {
         if (Eclipse::EclipseConfig::GetInstance().IsEclipseEnabled())
         {
-            Eclipse::EclipseLogger::GetInstance().LogTotalInitializationTime();
+            Eclipse::MapStateManager::GetInstance().Update(diff);
         }
     }
 };
@@ -2674,11 +2697,14 @@ public:
 
     void OnMapUpdate(Map* map, uint32 diff) override
     {
+        // The global state's messages are delivered on the world tick, maps update in parallel
         auto* globalEngine = Eclipse::MapStateManager::GetInstance().GetGlobalState();
-        if (globalEngine)
-            globalEngine->ProcessMessages();
 
-        auto* mapEngine = Eclipse::MapStateManager::GetInstance().GetStateForMap(map->GetId());
+        // An empty map does not bring back an evicted state unless messages are waiting for it
+        auto& stateManager = Eclipse::MapStateManager::GetInstance();
+        auto* mapEngine = (map->HavePlayers() || Eclipse::MessageManager::GetInstance().HasPendingMessages(map->GetId()))
+            ? stateManager.GetStateForMap(map->GetId())
+            : stateManager.FindStateForMap(map->GetId());
         if (mapEngine && mapEngine != globalEngine)
             mapEngine->ProcessMessages();
 
@@ -2686,6 +2712,10 @@ public:
             map,
             diff
         );
+
+        // Spend the slack after the map update on collection instead of inside the next event
+        if (mapEngine && mapEngine != globalEngine)
+            mapEngine->StepGarbageCollector();
     }
 };
 
@@ -2703,7 +2733,14 @@ public:
 
         if (cmd.find("reload eclipse") == 0)
         {
-            Eclipse::MapStateManager::GetInstance().ReloadAllScripts();
+            // `.reload eclipse full` rebuilds every state, `.reload eclipse async` rebuilds them
+            // off the world thread, otherwise only modified scripts are re-executed
+            if (cmd.find("full", 14) != std::string::npos)
+                Eclipse::MapStateManager::GetInstance().ReloadAllScripts();
+            else if (cmd.find("async", 14) != std::string::npos)
+                Eclipse::MapStateManager::GetInstance().StartBackgroundReload();
+            else
+                Eclipse::MapStateManager::GetInstance().ReloadModifiedScripts();
             return false;
         }
 
@@ -23,10 +23,42 @@ namespace Eclipse
         // Boolean configurations
         SetConfigValue<bool>(EclipseConfigValues::ENABLED, "Eclipse.Enabled", false);
         SetConfigValue<bool>(EclipseConfigValues::COMPATIBILITY, "Eclipse.Compatibility", true);
+        SetConfigValue<bool>(EclipseConfigValues::STATE_EVICTION_ENABLED, "Eclipse.StateEviction.Enabled", false);
+        SetConfigValue<bool>(EclipseConfigValues::BYTECODE_CACHE_ENABLED, "Eclipse.BytecodeCache.Enabled", true);
+        SetConfigValue<bool>(EclipseConfigValues::SCRIPT_WATCHER_ENABLED, "Eclipse.ScriptWatcher.Enabled", false);
+        SetConfigValue<bool>(EclipseConfigValues::STRIP_BYTECODE, "Eclipse.StripBytecode", false);
+
+#if LUA_VERSION_NUM < 503 && !SOL_LUAJIT
+        // lua_dump has no strip argument before 5.3, the bytecode would keep its debug information
+        if (GetConfigValue<bool>(EclipseConfigValues::STRIP_BYTECODE))
+        {
+            LOG_WARN("server.eclipse", "[Eclipse]: Eclipse.StripBytecode requires Lua 5.3+ or LuaJIT, disabled for {}", LUA_RELEASE);
+            OverwriteConfigValue<bool>(EclipseConfigValues::STRIP_BYTECODE, false);
+        }
+#endif
 
         // String configurations  
         SetConfigValue<std::string>(EclipseConfigValues::SCRIPT_PATH, "Eclipse.ScriptPath", "lua_scripts");
         SetConfigValue<std::string>(EclipseConfigValues::REQUIRE_PATH_EXTRA, "Eclipse.RequirePaths", "");
         SetConfigValue<std::string>(EclipseConfigValues::REQUIRE_CPATH_EXTRA, "Eclipse.RequireCPaths", "");
+        SetConfigValue<std::string>(EclipseConfigValues::GC_MODE, "Eclipse.GC.Mode", "incremental");
+        SetConfigValue<std::string>(EclipseConfigValues::BYTECODE_CACHE_PATH, "Eclipse.BytecodeCache.Path", "lua_cache");
+        SetConfigValue<std::string>(EclipseConfigValues::SCRIPT_PACK, "Eclipse.ScriptPack", "");
+
+        // Numeric configurations
+        SetConfigValue<uint32>(EclipseConfigValues::STATE_EVICTION_IDLE_TIME, "Eclipse.StateEviction.IdleTime", 300);
+        SetConfigValue<uint32>(EclipseConfigValues::STATE_EVICTION_MEMORY_BUDGET, "Eclipse.StateEviction.MemoryBudget", 0);
+        SetConfigValue<uint32>(EclipseConfigValues::MEMORY_SOFT_LIMIT, "Eclipse.Memory.SoftLimit", 0);
+        SetConfigValue<uint32>(EclipseConfigValues::MEMORY_HARD_LIMIT, "Eclipse.Memory.HardLimit", 0);
+        SetConfigValue<uint32>(EclipseConfigValues::GC_PAUSE, "Eclipse.GC.Pause", 0);
+        SetConfigValue<uint32>(EclipseConfigValues::GC_STEP_MULTIPLIER, "Eclipse.GC.StepMultiplier", 0);
+        SetConfigValue<uint32>(EclipseConfigValues::GC_STEP_BUDGET, "Eclipse.GC.StepBudget", 500);
+        SetConfigValue<uint32>(EclipseConfigValues::COMPILE_THREADS, "Eclipse.CompileThreads", 0);
+        SetConfigValue<uint32>(EclipseConfigValues::SCRIPT_WATCHER_DEBOUNCE, "Eclipse.ScriptWatcher.Debounce", 300);
+        SetConfigValue<uint32>(EclipseConfigValues::MESSAGE_TIME_BUDGET, "Eclipse.Messages.TimeBudget", 2000);
+        SetConfigValue<uint32>(EclipseConfigValues::MESSAGE_COUNT_BUDGET, "Eclipse.Messages.CountBudget", 500);
+        SetConfigValue<uint32>(EclipseConfigValues::MESSAGE_BACKLOG_WARNING, "Eclipse.Messages.BacklogWarning", 5000);
+        SetConfigValue<uint32>(EclipseConfigValues::MESSAGE_CALL_TIMEOUT, "Eclipse.Messages.CallTimeout", 5000);
+        SetConfigValue<uint32>(EclipseConfigValues::MESSAGE_MAILBOX_LIMIT, "Eclipse.Messages.MailboxLimit", 100000);
     }
 }
\ No newline at end of file
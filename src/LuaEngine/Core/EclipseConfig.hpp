@@ -10,11 +10,34 @@ namespace Eclipse
         // Boolean configurations
         ENABLED = 0,
         COMPATIBILITY,
+        STATE_EVICTION_ENABLED,
+        BYTECODE_CACHE_ENABLED,
+        SCRIPT_WATCHER_ENABLED,
+        STRIP_BYTECODE,
 
         // String configurations  
         SCRIPT_PATH,
         REQUIRE_PATH_EXTRA,
         REQUIRE_CPATH_EXTRA,
+        GC_MODE,
+        BYTECODE_CACHE_PATH,
+        SCRIPT_PACK,
+
+        // Numeric configurations
+        STATE_EVICTION_IDLE_TIME,
+        STATE_EVICTION_MEMORY_BUDGET,
+        MEMORY_SOFT_LIMIT,
+        MEMORY_HARD_LIMIT,
+        GC_PAUSE,
+        GC_STEP_MULTIPLIER,
+        GC_STEP_BUDGET,
+        COMPILE_THREADS,
+        SCRIPT_WATCHER_DEBOUNCE,
+        MESSAGE_TIME_BUDGET,
+        MESSAGE_COUNT_BUDGET,
+        MESSAGE_BACKLOG_WARNING,
+        MESSAGE_CALL_TIMEOUT,
+        MESSAGE_MAILBOX_LIMIT,
 
         
         CONFIG_VALUE_COUNT
@@ -29,10 +52,32 @@ namespace Eclipse
 
         bool IsEclipseEnabled() const { return GetConfigValue<bool>(EclipseConfigValues::ENABLED); }
         bool IsCompatibilityEnabled() const { return GetConfigValue<bool>(EclipseConfigValues::COMPATIBILITY); }
+        bool IsStateEvictionEnabled() const { return GetConfigValue<bool>(EclipseConfigValues::STATE_EVICTION_ENABLED); }
+        bool IsBytecodeCacheEnabled() const { return GetConfigValue<bool>(EclipseConfigValues::BYTECODE_CACHE_ENABLED); }
+        bool IsScriptWatcherEnabled() const { return GetConfigValue<bool>(EclipseConfigValues::SCRIPT_WATCHER_ENABLED); }
+        bool IsStripBytecodeEnabled() const { return GetConfigValue<bool>(EclipseConfigValues::STRIP_BYTECODE); }
         
         std::string_view GetScriptPath() const { return GetConfigValue(EclipseConfigValues::SCRIPT_PATH); }
         std::string_view GetRequirePathExtra() const { return GetConfigValue(EclipseConfigValues::REQUIRE_PATH_EXTRA); }
         std::string_view GetRequireCPathExtra() const { return GetConfigValue(EclipseConfigValues::REQUIRE_CPATH_EXTRA); }
+        std::string_view GetGCMode() const { return GetConfigValue(EclipseConfigValues::GC_MODE); }
+        std::string_view GetBytecodeCachePath() const { return GetConfigValue(EclipseConfigValues::BYTECODE_CACHE_PATH); }
+        std::string_view GetScriptPack() const { return GetConfigValue(EclipseConfigValues::SCRIPT_PACK); }
+
+        uint32 GetStateEvictionIdleTime() const { return GetConfigValue<uint32>(EclipseConfigValues::STATE_EVICTION_IDLE_TIME); }
+        uint32 GetStateEvictionMemoryBudget() const { return GetConfigValue<uint32>(EclipseConfigValues::STATE_EVICTION_MEMORY_BUDGET); }
+        uint32 GetMemorySoftLimit() const { return GetConfigValue<uint32>(EclipseConfigValues::MEMORY_SOFT_LIMIT); }
+        uint32 GetMemoryHardLimit() const { return GetConfigValue<uint32>(EclipseConfigValues::MEMORY_HARD_LIMIT); }
+        uint32 GetGCPause() const { return GetConfigValue<uint32>(EclipseConfigValues::GC_PAUSE); }
+        uint32 GetGCStepMultiplier() const { return GetConfigValue<uint32>(EclipseConfigValues::GC_STEP_MULTIPLIER); }
+        uint32 GetGCStepBudget() const { return GetConfigValue<uint32>(EclipseConfigValues::GC_STEP_BUDGET); }
+        uint32 GetCompileThreads() const { return GetConfigValue<uint32>(EclipseConfigValues::COMPILE_THREADS); }
+        uint32 GetScriptWatcherDebounce() const { return GetConfigValue<uint32>(EclipseConfigValues::SCRIPT_WATCHER_DEBOUNCE); }
+        uint32 GetMessageTimeBudget() const { return GetConfigValue<uint32>(EclipseConfigValues::MESSAGE_TIME_BUDGET); }
+        uint32 GetMessageCountBudget() const { return GetConfigValue<uint32>(EclipseConfigValues::MESSAGE_COUNT_BUDGET); }
+        uint32 GetMessageBacklogWarning() const { return GetConfigValue<uint32>(EclipseConfigValues::MESSAGE_BACKLOG_WARNING); }
+        uint32 GetMessageCallTimeout() const { return GetConfigValue<uint32>(EclipseConfigValues::MESSAGE_CALL_TIMEOUT); }
+        uint32 GetMessageMailboxLimit() const { return GetConfigValue<uint32>(EclipseConfigValues::MESSAGE_MAILBOX_LIMIT); }
 
     protected:
         void BuildConfigCache() override;
@@ -14,5 +14,6 @@
 #include "Map.h"
 #include "Item.h"
 #include "MapMgr.h"
+#include "Timer.h"
 
 #include <sol/sol.hpp>
\ No newline at end of file
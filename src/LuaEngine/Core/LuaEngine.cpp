@@ -8,6 +8,8 @@
 #include "LuaCache.hpp"
 #include "LuaPathManager.hpp"
 #include "EclipseLogger.hpp"
+#include "TableSnapshots.hpp"
+#include <algorithm>
 #include <filesystem>
 #include <mutex>
 #include <chrono>
@@ -17,7 +19,7 @@
 
 namespace Eclipse
 {
-    LuaEngine::LuaEngine() : luaState(), isInitialized(false), scriptsDirectory("lua_scripts"), stateMapId(-1), eventManager(std::make_unique<EventManager>())
+    LuaEngine::LuaEngine() : luaState(), isInitialized(false), scriptsDirectory("lua_scripts"), stateMapId(-1), eventManager(std::make_unique<EventManager>()), lastActiveTime(getMSTime())
     {
     }
 
@@ -36,11 +38,13 @@ namespace Eclipse
 
         try
         {
-            if (!luaState.Initialize())
+            if (!luaState.Initialize(stateMapId))
             {
                 throw std::runtime_error("Failed to initialize LuaState");
             }
 
+            mailbox = &MessageManager::GetInstance().OpenMailbox(stateMapId);
+
             RegisterBindings();
 
             isInitialized = true;
@@ -51,7 +55,8 @@ namespace Eclipse
             auto duration = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime);
 
             // Add this state's initialization time to the total
-            EclipseLogger::GetInstance().AddStateInitializationTime(duration.count());
+            if (!staged)
+                EclipseLogger::GetInstance().AddStateInitializationTime(duration.count());
 
             return true;
         }
@@ -63,6 +68,62 @@ namespace Eclipse
         }
     }
 
+    bool LuaEngine::InitializeStaged(int32 mapId, const std::vector<CompiledScript>& scripts)
+    {
+        staged = true;
+        stagedScripts = &scripts;
+
+        bool success = Initialize(mapId);
+
+        stagedScripts = nullptr;
+        return success;
+    }
+
+    void LuaEngine::Activate()
+    {
+        if (!staged)
+            return;
+
+        staged = false;
+
+        for (MessageTypeId messageType = 1; messageType < messageHandlers.size(); ++messageType)
+        {
+            if (!messageHandlers[messageType].empty())
+                MessageManager::GetInstance().Subscribe(stateMapId, messageType);
+        }
+    }
+
+    void LuaEngine::RegisterMessageHandler(MessageTypeId messageType, sol::function callback)
+    {
+        if (!callback.valid())
+            return;
+
+        uint32 chunkId = GetChunkId(callback);
+
+        // Delivery walks the handler lists in place, handlers added by a handler wait for it to end
+        if (deliveringMessage)
+        {
+            deferredHandlers.emplace_back(messageType, MessageHandler(std::move(callback), chunkId));
+            return;
+        }
+
+        AddMessageHandler(messageType, MessageHandler(std::move(callback), chunkId));
+    }
+
+    void LuaEngine::AddMessageHandler(MessageTypeId messageType, MessageHandler&& handler)
+    {
+        if (messageType >= messageHandlers.size())
+            messageHandlers.resize(messageType + 1);
+
+        auto& handlers = messageHandlers[messageType];
+
+        // A staged state must not receive broadcasts addressed to the live state it will replace
+        if (handlers.empty() && !staged)
+            MessageManager::GetInstance().Subscribe(stateMapId, messageType);
+
+        handlers.push_back(std::move(handler));
+    }
+
     void LuaEngine::Shutdown()
     {
         if (isInitialized)
@@ -93,6 +154,87 @@ namespace Eclipse
         }
     }
 
+    bool LuaEngine::ReloadScript(const std::string& scriptPath)
+    {
+        if (!isInitialized)
+            return false;
+
+        UnloadScript(scriptPath);
+
+        auto bytecode = LuaCache::GetInstance().GetBytecode(scriptPath);
+        if (!bytecode)
+        {
+            EclipseLogger::GetInstance().LogLuaError(scriptPath, "No compiled bytecode available for reload in state " + std::to_string(stateMapId));
+            return false;
+        }
+
+        bool success = ScriptLoader::LoadBytecodeIntoState(GetState(), bytecode->Data(), bytecode->Size(), scriptPath);
+
+        // Map states reloading the same script decode what the global state just rebuilt
+        if (stateMapId == -1)
+            TableSnapshots::GetInstance().Publish(GetState().lua_state(), false);
+
+        if (!success)
+        {
+            return false;
+        }
+
+        loadedScripts.push_back(scriptPath);
+        EclipseLogger::GetInstance().LogScriptReload(scriptPath);
+        return true;
+    }
+
+    void LuaEngine::UnloadScript(const std::string& scriptPath)
+    {
+        auto it = chunkIds.find(scriptPath);
+        if (it != chunkIds.end())
+        {
+            eventManager->ClearChunkEvents(it->second);
+
+            uint32 chunkId = it->second;
+            for (MessageTypeId messageType = 0; messageType < messageHandlers.size(); ++messageType)
+            {
+                // Broadcasts of a type nothing handles any more would only fill the mailbox. A staged
+                // state never subscribed, the subscription under its id belongs to the live state.
+                auto& handlers = messageHandlers[messageType];
+                if (std::erase_if(handlers, [chunkId](const MessageHandler& handler) { return handler.chunkId == chunkId; }) && handlers.empty() && !staged)
+                    MessageManager::GetInstance().Unsubscribe(stateMapId, messageType);
+            }
+        }
+
+        std::erase(loadedScripts, scriptPath);
+    }
+
+    uint32 LuaEngine::GetChunkId(const sol::function& callback)
+    {
+        lua_State* L = GetState().lua_state();
+        std::string chunkName;
+
+        // Registrations made later, from a handler or a continuation, still belong to the
+        // script that defined the callback
+        if (callback.valid())
+        {
+            callback.push(L);
+
+            lua_Debug ar;
+            if (lua_getinfo(L, ">S", &ar) && ar.source)
+            {
+                std::string source = ar.source;
+                if (chunkIds.count(source) || std::find(loadedScripts.begin(), loadedScripts.end(), source) != loadedScripts.end())
+                    chunkName = std::move(source);
+            }
+        }
+
+        if (chunkName.empty())
+            chunkName = ScriptLoader::GetActiveChunk(L);
+
+        if (chunkName.empty())
+            return 0;
+
+        auto [it, inserted] = chunkIds.try_emplace(std::move(chunkName), static_cast<uint32>(chunkIds.size() + 1));
+        return it->second;
+    }
+
     void LuaEngine::ReloadScripts()
     {
         if (!isInitialized)
@@ -113,7 +255,7 @@ namespace Eclipse
 
         // Reset Lua state but keep it initialized
         luaState.Reset();
-        if (!luaState.Initialize())
+        if (!luaState.Initialize(stateMapId))
         {
             EclipseLogger::GetInstance().LogError("Failed to reinitialize LuaState during reload");
             return;
@@ -129,10 +271,143 @@ namespace Eclipse
 
     void LuaEngine::ProcessMessages()
     {
-        if (isInitialized)
+        if (!isInitialized || !mailbox)
+            return;
+
+        const auto& config = EclipseConfig::GetInstance();
+        uint32 countBudget = config.GetMessageCountBudget();
+        uint32 timeBudget = config.GetMessageTimeBudget();
+
+        // Messages sent by the handlers themselves wait for the next update
+        size_t pending = mailbox->GetSize();
+        if (countBudget && pending > countBudget)
+            pending = countBudget;
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(timeBudget);
+        while (pending--)
         {
-            MessageManager::GetInstance().ProcessMessages(stateMapId);
+            auto message = mailbox->Pop();
+            if (!message)
+                break;
+
+            if (message->kind == StateMessageKind::REPLY)
+            {
+                ResolveCall(*message);
+            }
+            else
+            {
+                deliveringMessage = true;
+                MessageManager::DeliverMessage(GetState(), messageHandlers, *message);
+                deliveringMessage = false;
+
+                for (auto& [messageType, handler] : deferredHandlers)
+                {
+                    AddMessageHandler(messageType, std::move(handler));
+                }
+                deferredHandlers.clear();
+            }
+
+            if (timeBudget && std::chrono::steady_clock::now() >= deadline)
+                break;
         }
+
+        ExpireCalls();
+        ReportMessageBacklog();
+    }
+
+    std::shared_ptr<StateCall> LuaEngine::CallState(int32 toStateId, MessageTypeId messageType, sol::object data, uint32 timeout)
+    {
+        auto& manager = MessageManager::GetInstance();
+        auto deadline = StateCall::Clock::now() + std::chrono::milliseconds(timeout ? timeout : EclipseConfig::GetInstance().GetMessageCallTimeout());
+
+        std::string error;
+        uint32 callId = manager.SendRequest(stateMapId, toStateId, messageType, data, error);
+        auto call = std::make_shared<StateCall>(GetState().lua_state(), callId, deadline);
+
+        if (!callId)
+        {
+            call->Resolve(sol::lua_nil, sol::make_object(GetState(), error));
+            return call;
+        }
+
+        pendingCalls.emplace(callId, call);
+        callDeadlines.emplace(deadline, callId);
+        return call;
+    }
+
+    void LuaEngine::ResolveCall(const StateMessage& reply)
+    {
+        // Replies to calls that timed out or were made before a reload are dropped
+        auto it = pendingCalls.find(reply.callId);
+        if (it == pendingCalls.end())
+            return;
+
+        std::shared_ptr<StateCall> call = std::move(it->second);
+        pendingCalls.erase(it);
+
+        sol::object value;
+        if (!reply.error.empty())
+            call->Resolve(sol::lua_nil, sol::make_object(GetState(), reply.error));
+        else if (!MessageManager::DecodePayload(GetState(), reply, value))
+            call->Resolve(sol::lua_nil, sol::make_object(GetState(), "the reply is corrupt"));
+        else
+            call->Resolve(std::move(value), sol::lua_nil);
+    }
+
+    void LuaEngine::ExpireCalls()
+    {
+        auto now = StateCall::Clock::now();
+        while (!callDeadlines.empty() && callDeadlines.top().first <= now)
+        {
+            uint32 callId = callDeadlines.top().second;
+            callDeadlines.pop();
+
+            auto it = pendingCalls.find(callId);
+            if (it == pendingCalls.end())
+                continue;
+
+            std::shared_ptr<StateCall> call = std::move(it->second);
+            pendingCalls.erase(it);
+            call->Resolve(sol::lua_nil, sol::make_object(GetState(), "timeout"));
+        }
+    }
+
+    void LuaEngine::CancelCalls()
+    {
+        for (auto& [callId, call] : pendingCalls)
+        {
+            call->Cancel();
+        }
+
+        pendingCalls.clear();
+        callDeadlines = {};
+    }
+
+    void LuaEngine::ReportMessageBacklog()
+    {
+        uint32 threshold = EclipseConfig::GetInstance().GetMessageBacklogWarning();
+        if (!threshold)
+            return;
+
+        size_t backlog = mailbox->GetSize();
+        if (!backlogReported && backlog >= threshold)
+        {
+            backlogReported = true;
+            EclipseLogger::GetInstance().LogWarn("State " + std::to_string(stateMapId) + " has " + std::to_string(backlog) + " queued messages, handlers cannot keep up with the senders");
+        }
+        else if (backlogReported && backlog < threshold / 2)
+        {
+            backlogReported = false;
+        }
+    }
+
+    bool LuaEngine::HasPendingWork() const
+    {
+        if (!pendingCalls.empty() || (mailbox && !mailbox->IsEmpty()))
+            return true;
+
+        // Map update callbacks act as the state's timers
+        return eventManager && eventManager->HasCallbacksFor<Map*>(MAP_EVENT_ON_UPDATE);
     }
 
     void LuaEngine::ClearAllEvents()
@@ -149,8 +424,8 @@ namespace Eclipse
 
     void LuaEngine::ShutdownComponents()
     {
-        // Clean up message handlers for this state
-        MessageManager::GetInstance().ClearStateHandlers(stateMapId);
+        // Handlers reference the Lua state, they go before it
+        ClearMessageHandlers();
 
         // Clear all events for this state
         ClearAllEvents();
@@ -170,18 +445,25 @@ namespace Eclipse
 
         if (!globalState)
         {
-            globalState = std::make_unique<sol::state>();
-            globalState->open_libraries();
-
-            // Initialize paths once and apply to global state
-            LuaPathManager::GetInstance().InitializeDefaultPaths();
-            LuaPathManager::GetInstance().ApplyPaths(*globalState);
+            globalState = CreateCompilerState();
             EclipseLogger::GetInstance().LogDebug("Global compiler state created and paths applied");
         }
 
         return *globalState;
     }
 
+    std::unique_ptr<sol::state> LuaEngine::CreateCompilerState()
+    {
+        auto compilerState = std::make_unique<sol::state>();
+        compilerState->open_libraries();
+
+        // Initialize paths once and apply to the compiler state
+        LuaPathManager::GetInstance().InitializeDefaultPaths();
+        LuaPathManager::GetInstance().ApplyPaths(*compilerState);
+
+        return compilerState;
+    }
+
     void LuaEngine::RegisterBindings()
     {
         auto& state = luaState.GetState();
@@ -199,10 +481,10 @@ namespace Eclipse
 
     bool LuaEngine::LoadCachedScriptsFromGlobalState()
     {
-        auto& cache = LuaCache::GetInstance();
-        auto cachedScripts = cache.GetAllCachedScripts();
+        // One snapshot for the whole load, executed straight from the shared buffers
+        CacheSnapshotRef snapshot = LuaCache::GetInstance().GetSnapshot();
 
-        if (cachedScripts.empty())
+        if (snapshot->entries.empty())
         {
             // Silent return for map states when no scripts are cached yet
             // This is normal behavior when global state hasn't compiled scripts yet
@@ -210,41 +492,80 @@ namespace Eclipse
         }
 
         int successCount = 0;
-        for (const auto& scriptPath : cachedScripts)
+        for (const auto& [scriptPath, entry] : snapshot->entries)
         {
-            auto bytecode = cache.GetBytecode(scriptPath);
-            if (bytecode.has_value())
+            if (!entry.compilationSuccess || !entry.bytecode)
+                continue;
+
+            if (ScriptLoader::LoadBytecodeIntoState(GetState(), entry.bytecode->Data(), entry.bytecode->Size(), scriptPath))
             {
-                if (ScriptLoader::LoadBytecodeIntoState(GetState(), bytecode.value(), scriptPath))
-                {
-                    loadedScripts.push_back(scriptPath);
-                    successCount++;
-                }
-                else
-                {
-                    EclipseLogger::GetInstance().LogLuaError(scriptPath, "Failed to load cached script into state " + std::to_string(stateMapId));
-                }
+                loadedScripts.push_back(scriptPath);
+                successCount++;
+            }
+            else
+            {
+                EclipseLogger::GetInstance().LogLuaError(scriptPath, "Failed to load cached script into state " + std::to_string(stateMapId));
             }
         }
 
         return successCount > 0;
     }
 
+    void LuaEngine::ClearMessageHandlers()
+    {
+        // Pending messages were addressed to the scripts being dropped, a staged state shares the live mailbox
+        if (!staged)
+        {
+            MessageManager::GetInstance().UnsubscribeAll(stateMapId);
+            if (mailbox)
+                mailbox->Discard();
+        }
+
+        messageHandlers.clear();
+        deferredHandlers.clear();
+        CancelCalls();
+    }
+
     void LuaEngine::ClearStateData()
     {
-        MessageManager::GetInstance().ClearStateHandlers(stateMapId);
+        ClearMessageHandlers();
         ClearAllEvents();
         loadedScripts.clear();
     }
 
+    void LuaEngine::LoadStagedScripts()
+    {
+        for (const auto& script : *stagedScripts)
+        {
+            if (ScriptLoader::LoadBytecodeIntoState(GetState(), script.bytecode, script.path))
+            {
+                loadedScripts.push_back(script.path);
+            }
+        }
+    }
+
     void LuaEngine::LoadScriptsForState()
     {
         LoadStatistics stats;
-        if (stateMapId == -1)
+        if (stagedScripts)
+        {
+            // Staged states: execute the scripts compiled by the background reload
+            auto startTime = std::chrono::high_resolution_clock::now();
+            LoadStagedScripts();
+            auto endTime = std::chrono::high_resolution_clock::now();
+
+            stats.duration = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count();
+            stats.cached = loadedScripts.size();
+        }
+        else if (stateMapId == -1)
         {
-            // Global compiler state: discover and compile all scripts
-            EclipseLogger::GetInstance().LogDebug("Global state (-1): Sequential compilation");
-            ScriptLoader::LoadDirectory(GetState(), GetGlobalCompilerState(), scriptsDirectory, loadedScripts, &stats);
+            // Global state: execute the script pack if one is configured, otherwise discover and compile all scripts
+            std::string packPath(EclipseConfig::GetInstance().GetScriptPack());
+            if (packPath.empty() || !ScriptLoader::LoadPack(GetState(), packPath, scriptsDirectory, loadedScripts, &stats))
+            {
+                EclipseLogger::GetInstance().LogDebug("Global state (-1): Parallel compilation");
+                ScriptLoader::LoadDirectory(GetState(), scriptsDirectory, loadedScripts, &stats);
+            }
         }
         else
         {
@@ -260,6 +581,13 @@ namespace Eclipse
             stats.cached = loadedScripts.size();
             stats.precompiled = 0;
         }
+
+        // Scripts may keep filling a snapshot table after defining it, it is taken once all of them ran
+        if (stateMapId == -1 && staged)
+            TableSnapshots::GetInstance().PublishStaged(GetState().lua_state());
+        else if (stateMapId == -1)
+            TableSnapshots::GetInstance().Publish(GetState().lua_state());
+
         EclipseLogger::GetInstance().LogLoadStatistics(stateMapId, stats.GetSuccessful(), stats.compiled, stats.cached, stats.precompiled, stats.duration);
     }
 }
\ No newline at end of file
@@ -2,11 +2,16 @@
 #define ECLIPSE_LUA_ENGINE_HPP
 
 #include "LuaState.hpp"
+#include "MessageManager.hpp"
+#include "StateCall.hpp"
+#include <atomic>
 #include <memory>
+#include <queue>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
-namespace Eclipse { struct LoadStatistics; }
+namespace Eclipse { struct LoadStatistics; struct CompiledScript; }
 
 namespace Eclipse
 {
@@ -17,21 +22,53 @@ namespace Eclipse
         ~LuaEngine();
 
         bool Initialize(int32 mapId = -1);
+
+        // Build a replacement state from pre-compiled scripts without touching live routing,
+        // Activate() then subscribes its message handlers once it replaces the live state
+        bool InitializeStaged(int32 mapId, const std::vector<CompiledScript>& scripts);
+        void Activate();
+        bool IsStaged() const { return staged; }
         void Shutdown();
         void ReloadScripts();
 
         int32 GetStateMapId() const { return stateMapId; }
+        const std::string& GetScriptsDirectory() const { return scriptsDirectory; }
 
         bool LoadScript(const std::string& scriptPath);
 
+        // Incremental reload: drop the registrations a chunk made and re-execute it from cache
+        bool ReloadScript(const std::string& scriptPath);
+        void UnloadScript(const std::string& scriptPath);
+
+        // Chunk owning a registration: the script that defined the callback, or the script
+        // loading right now when the callback carries no source (stripped bytecode). 0 if neither.
+        uint32 GetChunkId(const sol::function& callback);
+
         // Access to global compiler state (state -1)
         static sol::state& GetGlobalCompilerState();
+        static std::unique_ptr<sol::state> CreateCompilerState();
+
+        void RegisterMessageHandler(MessageTypeId messageType, sol::function callback);
+
+        // Request answered by the target state's handlers, resolved on one of this state's updates
+        std::shared_ptr<StateCall> CallState(int32 toStateId, MessageTypeId messageType, sol::object data, uint32 timeout);
 
         sol::state& GetState() { return luaState.GetState(); }
         class EventManager* GetEventManager() const noexcept { return eventManager.get(); }
 
+        // Delivers queued messages within the configured budget, only from the thread
+        // updating this state. What is left waits for the next update.
         void ProcessMessages();
 
+        // Activity tracking for idle state eviction
+        void MarkActive() { lastActiveTime.store(getMSTime(), std::memory_order_relaxed); }
+        uint32 GetIdleTime() const { return GetMSTimeDiffToNow(lastActiveTime.load(std::memory_order_relaxed)); }
+        bool HasPendingWork() const;
+        size_t GetMemoryUsage() const { return luaState.GetMemoryUsage(); }
+        size_t GetPeakMemoryUsage() const { return luaState.GetPeakMemoryUsage(); }
+        void CheckMemoryLimits() { luaState.CheckMemoryLimits(); }
+        void StepGarbageCollector() { luaState.StepGarbageCollector(); }
+
         void ClearAllEvents();
 
 
@@ -42,12 +79,36 @@ namespace Eclipse
         std::string scriptsDirectory;
         int32 stateMapId; // -1 = global/world state, >=0 = specific map
         std::unique_ptr<class EventManager> eventManager;
+        std::unordered_map<std::string, uint32> chunkIds;
+        std::atomic<uint32> lastActiveTime;
+
+        // Only touched by the thread updating this state
+        MessageHandlerTable messageHandlers;
+        std::vector<std::pair<MessageTypeId, MessageHandler>> deferredHandlers;
+        bool deliveringMessage = false;
+
+        // Calls waiting for their reply, deadlines of completed calls are skipped when they come up
+        std::unordered_map<uint32, std::shared_ptr<StateCall>> pendingCalls;
+        std::priority_queue<std::pair<StateCall::Clock::time_point, uint32>,
+            std::vector<std::pair<StateCall::Clock::time_point, uint32>>, std::greater<>> callDeadlines;
+        StateMailbox* mailbox = nullptr;
+        bool backlogReported = false;
+
+        bool staged = false;
+        const std::vector<CompiledScript>* stagedScripts = nullptr;
 
         void RegisterBindings();
         void ShutdownComponents();
         void ClearStateData();
+        void ClearMessageHandlers();
+        void AddMessageHandler(MessageTypeId messageType, MessageHandler&& handler);
+        void ReportMessageBacklog();
+        void ResolveCall(const StateMessage& reply);
+        void ExpireCalls();
+        void CancelCalls();
         void LoadScriptsForState();
         bool LoadCachedScriptsFromGlobalState();
+        void LoadStagedScripts();
     };
 }
 
@@ -2,6 +2,16 @@
 #include "EclipseIncludes.hpp"
 #include "EclipseConfig.hpp"
 #include "EclipseLogger.hpp"
+#include "EventManager.hpp"
+#include "LuaCache.hpp"
+#include "LuaCompiler.hpp"
+#include "LineMap.hpp"
+#include "CompilerPool.hpp"
+#include "ScriptWatcher.hpp"
+#include "ScriptLoader.hpp"
+#include "TableSnapshots.hpp"
+#include <boost/filesystem.hpp>
+#include <algorithm>
 #include <chrono>
 
 namespace Eclipse
@@ -12,6 +22,14 @@ namespace Eclipse
         return instance;
     }
 
+    MapStateManager::~MapStateManager()
+    {
+        if (reloadWorker.joinable())
+        {
+            reloadWorker.join();
+        }
+    }
+
     LuaEngine* MapStateManager::GetStateForMap(int32 mapId)
     {
         // In compatibility mode, always return global state (-1) except when explicitly requested
@@ -20,9 +38,18 @@ namespace Eclipse
             EclipseLogger::GetInstance().LogDebug("Compatibility mode: redirecting map " + std::to_string(mapId) + " to global state (-1)");
             return GetStateForMap(-1);
         }
-        
+
+        // Map states load their scripts from the global state's cache, it has to exist first
+        if (mapId != -1 && !mapStates.count(mapId) && !mapStates.count(-1))
+            GetGlobalState();
+
         auto [it, inserted] = mapStates.try_emplace(mapId, nullptr);
-        if (!inserted) return it->second.get();
+        if (!inserted)
+        {
+            if (it->second)
+                it->second->MarkActive();
+            return it->second.get();
+        }
         
         auto engine = std::make_unique<LuaEngine>();
         EclipseLogger::GetInstance().LogDebug("Creating new Lua state for map " + std::to_string(mapId));
@@ -44,6 +71,17 @@ namespace Eclipse
         return GetStateForMap(-1);
     }
 
+    LuaEngine* MapStateManager::FindStateForMap(int32 mapId) const
+    {
+        if (mapId != -1 && EclipseConfig::GetInstance().IsCompatibilityEnabled())
+        {
+            mapId = -1;
+        }
+
+        auto it = mapStates.find(mapId);
+        return it != mapStates.end() ? it->second.get() : nullptr;
+    }
+
 
     void MapStateManager::UnloadMapState(int32 mapId)
     {
@@ -69,6 +107,12 @@ namespace Eclipse
 
     void MapStateManager::ReloadAllScripts()
     {
+        if (reloadStatus.load(std::memory_order_acquire) != ReloadStatus::Idle)
+        {
+            EclipseLogger::GetInstance().LogWarn("A background reload is in progress, reload skipped");
+            return;
+        }
+
         EclipseLogger::GetInstance().LogInfo("Searching scripts from `lua_scripts`");
         EclipseLogger::GetInstance().LogDebug("Starting script reload for " + std::to_string(mapStates.size()) + " states");
         
@@ -96,6 +140,439 @@ namespace Eclipse
         EclipseLogger::GetInstance().LogInfo("All scripts reloaded successfully in " + std::to_string(totalDuration.count()) + " ms");
     }
 
+    void MapStateManager::ReloadModifiedScripts()
+    {
+        if (reloadStatus.load(std::memory_order_acquire) != ReloadStatus::Idle)
+        {
+            EclipseLogger::GetInstance().LogWarn("A background reload is in progress, reload skipped");
+            return;
+        }
+
+        // A pack is replaced as a whole, there are no individual sources to compare
+        if (!EclipseConfig::GetInstance().GetScriptPack().empty())
+        {
+            ReloadAllScripts();
+            return;
+        }
+
+        auto* globalEngine = GetGlobalState();
+        if (!globalEngine)
+        {
+            return;
+        }
+
+        auto startTime = std::chrono::high_resolution_clock::now();
+        auto& cache = LuaCache::GetInstance();
+
+        std::vector<std::string> changedScripts;
+        std::vector<std::string> removedScripts;
+
+        for (auto& scriptPath : cache.GetModifiedScripts())
+        {
+            if (boost::filesystem::exists(scriptPath))
+                changedScripts.emplace_back(std::move(scriptPath));
+            else
+                removedScripts.emplace_back(std::move(scriptPath));
+        }
+
+        for (auto& scriptPath : ScriptLoader::DiscoverScripts(globalEngine->GetScriptsDirectory()))
+        {
+            if (!cache.Contains(scriptPath))
+                changedScripts.emplace_back(std::move(scriptPath));
+        }
+
+        if (changedScripts.empty() && removedScripts.empty())
+        {
+            EclipseLogger::GetInstance().LogInfo("No modified scripts to reload");
+            return;
+        }
+
+        // Compile once, every state then executes the same cached bytecode
+        std::vector<FileFingerprint> fingerprints;
+        auto compiled = CompilerPool::GetInstance().CompileAll(changedScripts, fingerprints);
+        size_t reloadedCount = ApplyScriptChanges(changedScripts, compiled, fingerprints, removedScripts);
+
+        auto endTime = std::chrono::high_resolution_clock::now();
+        auto totalDuration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
+
+        EclipseLogger::GetInstance().LogInfo("Reloaded " + std::to_string(reloadedCount) + "/" + std::to_string(changedScripts.size()) + " modified scripts, unloaded " + std::to_string(removedScripts.size()) + " in " + std::to_string(totalDuration.count()) + " ms");
+    }
+
+    size_t MapStateManager::ApplyScriptChanges(const std::vector<std::string>& changedScripts, std::vector<std::vector<char>>& compiled,
+        const std::vector<FileFingerprint>& sourceFingerprints, const std::vector<std::string>& removedScripts)
+    {
+        auto& cache = LuaCache::GetInstance();
+
+        std::vector<std::string> compiledScripts;
+        compiledScripts.reserve(changedScripts.size());
+
+        {
+            // Published as one snapshot before any state re-executes
+            LuaCache::UpdateScope cacheUpdate;
+
+            for (size_t i = 0; i < changedScripts.size(); ++i)
+            {
+                const auto& scriptPath = changedScripts[i];
+                bool success = !compiled[i].empty();
+
+                const FileFingerprint& fingerprint = sourceFingerprints[i];
+
+                // On failure the previous version keeps running in every state, states created
+                // later load it too. Only the fingerprint moves so the same edit is not retried.
+                if (!success && cache.GetBytecode(scriptPath))
+                {
+                    EclipseLogger::GetInstance().LogError("Failed to compile modified script " + scriptPath + ", keeping the previous version");
+                    cache.RefreshFingerprint(scriptPath, fingerprint);
+                    continue;
+                }
+
+                cache.StoreBytecode(scriptPath, std::move(compiled[i]), success, fingerprint);
+
+                if (success)
+                    compiledScripts.emplace_back(scriptPath);
+            }
+
+            for (const auto& scriptPath : removedScripts)
+            {
+                cache.InvalidateScript(scriptPath);
+                LineMap::GetInstance().Remove(scriptPath);
+            }
+        }
+
+        auto reloadState = [&](LuaEngine& engine)
+        {
+            for (const auto& scriptPath : removedScripts)
+            {
+                engine.UnloadScript(scriptPath);
+            }
+
+            for (const auto& scriptPath : compiledScripts)
+            {
+                engine.ReloadScript(scriptPath);
+            }
+        };
+
+        // The global state goes first, it republishes the table snapshots map states decode
+        if (auto* globalEngine = FindStateForMap(-1))
+            reloadState(*globalEngine);
+
+        for (auto& [mapId, engine] : mapStates)
+        {
+            if (engine && mapId != -1)
+                reloadState(*engine);
+        }
+
+        return compiledScripts.size();
+    }
+
+    void MapStateManager::ApplyWatchedChanges()
+    {
+        auto changes = ScriptWatcher::GetInstance().TakeCompiledChanges();
+        if (changes.empty())
+            return;
+
+        auto& cache = LuaCache::GetInstance();
+
+        std::vector<std::string> changedScripts;
+        std::vector<std::vector<char>> compiled;
+        std::vector<FileFingerprint> fingerprints;
+        std::vector<std::string> removedScripts;
+
+        for (auto& change : changes)
+        {
+            if (change.removed)
+            {
+                removedScripts.push_back(std::move(change.path));
+                continue;
+            }
+
+            // Saved without edits, or touched by a checkout: nothing to re-execute
+            if (cache.GetContentHash(change.path) == change.fingerprint.contentHash)
+                continue;
+
+            changedScripts.push_back(std::move(change.path));
+            compiled.push_back(std::move(change.bytecode));
+            fingerprints.push_back(change.fingerprint);
+        }
+
+        if (changedScripts.empty() && removedScripts.empty())
+            return;
+
+        size_t reloadedCount = ApplyScriptChanges(changedScripts, compiled, fingerprints, removedScripts);
+        EclipseLogger::GetInstance().LogInfo("Script watcher: reloaded " + std::to_string(reloadedCount) + "/" + std::to_string(changedScripts.size()) + " scripts, unloaded " + std::to_string(removedScripts.size()));
+    }
+
+    bool MapStateManager::StartBackgroundReload()
+    {
+        if (reloadStatus.load(std::memory_order_acquire) != ReloadStatus::Idle)
+        {
+            EclipseLogger::GetInstance().LogWarn("A background reload is already in progress");
+            return false;
+        }
+
+        auto* globalEngine = GetGlobalState();
+        if (!globalEngine)
+        {
+            return false;
+        }
+
+        // Staged states are compiled from sources, a pack has none
+        if (!EclipseConfig::GetInstance().GetScriptPack().empty())
+        {
+            EclipseLogger::GetInstance().LogInfo("Background reload is not available with a script pack, reloading the pack");
+            ReloadAllScripts();
+            return false;
+        }
+
+        if (reloadWorker.joinable())
+        {
+            reloadWorker.join();
+        }
+
+        // Discovery stays on the world thread, it shares its cache with the synchronous loaders
+        auto scripts = ScriptLoader::DiscoverScripts(globalEngine->GetScriptsDirectory());
+
+        std::vector<int32> mapIds;
+        mapIds.reserve(mapStates.size());
+        for (const auto& [mapId, engine] : mapStates)
+        {
+            if (engine)
+                mapIds.emplace_back(mapId);
+        }
+
+        // Built in order, the global state (-1) publishes the table snapshots the map states decode
+        std::sort(mapIds.begin(), mapIds.end());
+
+        EclipseLogger::GetInstance().LogInfo("Starting background reload of " + std::to_string(scripts.size()) + " scripts for " + std::to_string(mapIds.size()) + " states");
+
+        reloadStartTime = std::chrono::high_resolution_clock::now();
+        reloadStatus.store(ReloadStatus::Running, std::memory_order_release);
+        reloadWorker = std::thread(&MapStateManager::BuildStagedStates, this, std::move(scripts), std::move(mapIds));
+        return true;
+    }
+
+    void MapStateManager::BuildStagedStates(std::vector<std::string> scripts, std::vector<int32> mapIds)
+    {
+        std::vector<FileFingerprint> fingerprints;
+        auto compiled = CompilerPool::GetInstance().CompileAll(scripts, fingerprints);
+
+        bool compileFailed = false;
+        stagedScripts.reserve(scripts.size());
+
+        for (size_t i = 0; i < scripts.size(); ++i)
+        {
+            if (compiled[i].empty())
+            {
+                compileFailed = true;
+                continue;
+            }
+
+            stagedScripts.emplace_back(std::move(scripts[i]), std::move(compiled[i]), fingerprints[i]);
+        }
+
+        if (compileFailed)
+        {
+            reloadStatus.store(ReloadStatus::Failed, std::memory_order_release);
+            return;
+        }
+
+        for (int32 mapId : mapIds)
+        {
+            auto engine = std::make_unique<LuaEngine>();
+            if (!engine->InitializeStaged(mapId, stagedScripts))
+            {
+                reloadStatus.store(ReloadStatus::Failed, std::memory_order_release);
+                return;
+            }
+
+            stagedStates.emplace(mapId, std::move(engine));
+        }
+
+        reloadStatus.store(ReloadStatus::Ready, std::memory_order_release);
+    }
+
+    void MapStateManager::Update(uint32 diff)
+    {
+        for (auto& [mapId, engine] : mapStates)
+        {
+            if (engine)
+                engine->CheckMemoryLimits();
+        }
+
+        // Map states are stepped after their own map update, the global state has no map
+        if (auto* globalEngine = FindStateForMap(-1))
+        {
+            globalEngine->ProcessMessages();
+            globalEngine->StepGarbageCollector();
+        }
+
+        // Watcher changes wait while a background reload owns the states
+        if (reloadStatus.load(std::memory_order_acquire) == ReloadStatus::Idle)
+            ApplyWatchedChanges();
+
+        if (EclipseConfig::GetInstance().IsStateEvictionEnabled())
+        {
+            evictionTimer += diff;
+            if (evictionTimer >= EVICTION_CHECK_INTERVAL)
+            {
+                evictionTimer = 0;
+                EvictIdleStates();
+            }
+        }
+
+        ReloadStatus status = reloadStatus.load(std::memory_order_acquire);
+        if (status != ReloadStatus::Ready && status != ReloadStatus::Failed)
+        {
+            return;
+        }
+
+        reloadWorker.join();
+
+        if (status == ReloadStatus::Ready)
+        {
+            ApplyStagedStates();
+        }
+        else
+        {
+            TableSnapshots::GetInstance().DiscardStaged();
+            EclipseLogger::GetInstance().LogError("Background reload failed, keeping the current scripts");
+        }
+
+        stagedStates.clear();
+        stagedScripts.clear();
+        reloadStatus.store(ReloadStatus::Idle, std::memory_order_release);
+    }
+
+    void MapStateManager::ApplyStagedStates()
+    {
+        auto& cache = LuaCache::GetInstance();
+
+        // Publish the new bytecode first so states created from now on match the swapped ones
+        {
+            LuaCache::UpdateScope cacheUpdate;
+
+            cache.InvalidateAllScripts();
+            for (auto& script : stagedScripts)
+            {
+                cache.StoreBytecode(script.path, std::move(script.bytecode), true, script.fingerprint);
+            }
+        }
+
+        // States created or reloaded from now on run the new scripts, they decode the new tables
+        TableSnapshots::GetInstance().CommitStaged();
+
+        size_t swappedStates = 0;
+        for (auto& [mapId, engine] : mapStates)
+        {
+            auto stagedIt = stagedStates.find(mapId);
+            if (stagedIt == stagedStates.end())
+            {
+                // State created while the reload was running
+                engine->ReloadScripts();
+                continue;
+            }
+
+            engine->Shutdown();
+            engine = std::move(stagedIt->second);
+            engine->Activate();
+            ++swappedStates;
+        }
+
+        auto endTime = std::chrono::high_resolution_clock::now();
+        auto totalDuration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - reloadStartTime);
+
+        EclipseLogger::GetInstance().LogInfo("Background reload swapped in " + std::to_string(swappedStates) + " states after " + std::to_string(totalDuration.count()) + " ms");
+    }
+
+    void MapStateManager::EvictIdleStates()
+    {
+        // Never swap states out from under a background reload
+        if (reloadStatus.load(std::memory_order_acquire) != ReloadStatus::Idle)
+        {
+            return;
+        }
+
+        auto& config = EclipseConfig::GetInstance();
+        uint32 idleThreshold = config.GetStateEvictionIdleTime() * IN_MILLISECONDS;
+        size_t memoryBudget = static_cast<size_t>(config.GetStateEvictionMemoryBudget()) * 1024 * 1024;
+
+        struct EvictionCandidate
+        {
+            int32 mapId;
+            uint32 idleTime;
+            size_t memory;
+        };
+
+        std::vector<EvictionCandidate> candidates;
+        size_t totalMemory = 0;
+
+        for (const auto& [mapId, engine] : mapStates)
+        {
+            if (!engine)
+                continue;
+
+            size_t memory = engine->GetMemoryUsage();
+            totalMemory += memory;
+
+            // The global state is shared by every map and is never evicted
+            if (mapId == -1)
+                continue;
+
+            uint32 idleTime = engine->GetIdleTime();
+            if (idleTime >= idleThreshold && !engine->HasPendingWork())
+            {
+                candidates.push_back({ mapId, idleTime, memory });
+            }
+        }
+
+        if (candidates.empty())
+        {
+            return;
+        }
+
+        // Least recently used first
+        std::sort(candidates.begin(), candidates.end(), [](const EvictionCandidate& a, const EvictionCandidate& b)
+        {
+            return a.idleTime > b.idleTime;
+        });
+
+        size_t evicted = 0;
+        for (const auto& candidate : candidates)
+        {
+            if (memoryBudget && totalMemory <= memoryBudget)
+                break;
+
+            auto it = mapStates.find(candidate.mapId);
+            if (auto* eventManager = it->second->GetEventManager())
+            {
+                // Last chance for scripts to persist what they need
+                eventManager->TriggerTypedEvent<EventType::MAP>(MAP_EVENT_ON_STATE_EVICT, candidate.mapId);
+            }
+
+            EclipseLogger::GetInstance().LogDebug("Evicting idle Lua state for map " + std::to_string(candidate.mapId) + " (idle " + std::to_string(candidate.idleTime / IN_MILLISECONDS) + " s, " + std::to_string(candidate.memory / 1024) + " KB)");
+            UnloadMapState(candidate.mapId);
+
+            totalMemory -= std::min(totalMemory, candidate.memory);
+            ++evicted;
+        }
+
+        if (evicted)
+        {
+            EclipseLogger::GetInstance().LogInfo("Evicted " + std::to_string(evicted) + " idle Lua states, " + std::to_string(totalMemory / 1024) + " KB still in use");
+        }
+    }
+
+    size_t MapStateManager::GetTotalMemoryUsage() const
+    {
+        size_t totalMemory = 0;
+        for (const auto& [mapId, engine] : mapStates)
+        {
+            if (engine)
+                totalMemory += engine->GetMemoryUsage();
+        }
+        return totalMemory;
+    }
+
     std::vector<LuaEngine*> MapStateManager::GetAllActiveEngines() const
     {
         std::vector<LuaEngine*> engines;
@@ -3,9 +3,14 @@
 
 #include "EclipseIncludes.hpp"
 #include "LuaEngine.hpp"
+#include "ScriptLoader.hpp"
+#include "FileFingerprint.hpp"
 
+#include <atomic>
+#include <chrono>
 #include <unordered_map>
 #include <memory>
+#include <thread>
 
 namespace Eclipse
 {
@@ -16,10 +21,26 @@ namespace Eclipse
         
         LuaEngine* GetStateForMap(int32 mapId);
         LuaEngine* GetGlobalState();
+
+        // Lookup without creating, returns nullptr for unloaded or evicted states
+        LuaEngine* FindStateForMap(int32 mapId) const;
         
         void UnloadMapState(int32 mapId);
         void UnloadAllStates();
         void ReloadAllScripts();
+        void ReloadModifiedScripts();
+
+        // Off-thread reload: replacement states are built in the background and
+        // swapped in by Update() on the next world tick
+        bool StartBackgroundReload();
+        bool IsBackgroundReloadRunning() const { return reloadStatus.load(std::memory_order_acquire) == ReloadStatus::Running; }
+
+        // World tick, called while no map is updating
+        void Update(uint32 diff);
+
+        // Unload idle map states, least recently used first while over the memory budget
+        void EvictIdleStates();
+        size_t GetTotalMemoryUsage() const;
         
         // Statistics
         size_t GetActiveStateCount() const { return mapStates.size(); }
@@ -30,11 +51,38 @@ namespace Eclipse
         
     private:
         MapStateManager() = default;
-        ~MapStateManager() = default;
+        ~MapStateManager();
         MapStateManager(const MapStateManager&) = delete;
         MapStateManager& operator=(const MapStateManager&) = delete;
         
         std::unordered_map<int32, std::unique_ptr<LuaEngine>> mapStates;
+
+        static constexpr uint32 EVICTION_CHECK_INTERVAL = 5 * IN_MILLISECONDS;
+        uint32 evictionTimer = 0;
+
+        enum class ReloadStatus : uint8
+        {
+            Idle,
+            Running,
+            Ready,
+            Failed
+        };
+
+        std::thread reloadWorker;
+        std::atomic<ReloadStatus> reloadStatus{ ReloadStatus::Idle };
+        std::chrono::high_resolution_clock::time_point reloadStartTime;
+
+        // Owned by the reload worker while Running, by the world thread afterwards
+        std::vector<CompiledScript> stagedScripts;
+        std::unordered_map<int32, std::unique_ptr<LuaEngine>> stagedStates;
+
+        // Stores compiled scripts in the cache and re-executes them in every state
+        size_t ApplyScriptChanges(const std::vector<std::string>& changedScripts, std::vector<std::vector<char>>& compiled,
+            const std::vector<FileFingerprint>& sourceFingerprints, const std::vector<std::string>& removedScripts);
+        void ApplyWatchedChanges();
+
+        void BuildStagedStates(std::vector<std::string> scripts, std::vector<int32> mapIds);
+        void ApplyStagedStates();
     };
 }
 
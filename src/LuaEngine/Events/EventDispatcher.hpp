@@ -111,7 +111,9 @@ namespace Eclipse
             {
                 if (auto* objectMap = GetObjectMap(object))
                 {
-                    if (auto* mapEngine = manager.GetStateForMap(objectMap->GetId()))
+                    // Map-level events on an empty map must not bring an evicted state back
+                    bool idleMap = std::is_same_v<T, Map> && !objectMap->HavePlayers();
+                    if (auto* mapEngine = idleMap ? manager.FindStateForMap(objectMap->GetId()) : manager.GetStateForMap(objectMap->GetId()))
                     {
                         if (mapEngine != engines.front()) // Avoid duplicates
                         {
@@ -8,6 +8,16 @@
 
 namespace Eclipse
 {
+    // A registered callback and the script chunk that registered it. Called protected,
+    // errors come back through the state's traceback handler instead of its panic function.
+    struct EventCallback
+    {
+        sol::protected_function function;
+        uint32 chunkId;
+
+        EventCallback(sol::function fn, uint32 chunk) : function(std::move(fn)), chunkId(chunk) {}
+    };
+
     class EventManager
     {
     public:
@@ -17,7 +27,7 @@ namespace Eclipse
         EventManager& operator=(const EventManager&) = delete;
 
         template<EventType Type>
-        void RegisterEvent(uint32 eventId, sol::function callback);
+        void RegisterEvent(uint32 eventId, sol::function callback, uint32 chunkId = 0);
 
         template<typename... Args>
         void TriggerEvent(uint32 eventId, Args&&... args);
@@ -25,6 +35,10 @@ namespace Eclipse
         template<typename... Args>
         std::optional<std::any> TriggerWithRetValueEvent(uint32 eventId, Args&&... args);
 
+        // Trigger an event of an explicit category, for events that carry no game object
+        template<EventType Type, typename... Args>
+        void TriggerTypedEvent(uint32 eventId, Args&&... args);
+
         template<typename... Args>
         bool HasCallbacksFor(uint32 eventId) const;
 
@@ -32,7 +46,7 @@ namespace Eclipse
         void ClearEvents();
 
         template<EventType Type>
-        void RegisterKeyedEvent(uint32 objectId, uint32 eventId, sol::function callback);
+        void RegisterKeyedEvent(uint32 objectId, uint32 eventId, sol::function callback, uint32 chunkId = 0);
 
         template<EventType Type, typename... Args>
         void TriggerKeyedEvent(uint32 objectId, uint32 eventId, Args&&... args);
@@ -43,10 +57,12 @@ namespace Eclipse
         template<EventType Type>
         bool HasKeyedEvents(uint32 objectId) const;
 
+        // Remove every callback registered by the given script chunk
+        void ClearChunkEvents(uint32 chunkId);
 
     private:
-        std::unordered_map<EventType, std::unordered_map<uint32, std::vector<sol::function>>> events;
-        std::unordered_map<EventType, std::unordered_map<uint32, std::unordered_map<uint32, std::vector<sol::function>>>> keyedEvents;
+        std::unordered_map<EventType, std::unordered_map<uint32, std::vector<EventCallback>>> events;
+        std::unordered_map<EventType, std::unordered_map<uint32, std::unordered_map<uint32, std::vector<EventCallback>>>> keyedEvents;
 
         template<EventType Type>
         auto& GetEventContainer();
@@ -59,6 +75,8 @@ namespace Eclipse
 
         template<typename... Args>
         std::optional<std::any> TriggerWithRetValueEventWithRuntimeType(EventType eventType, uint32 eventId, Args&&... args);
+
+        static void LogCallbackError(const sol::protected_function_result& result);
     };
 
     // Template implementation
@@ -69,7 +87,7 @@ namespace Eclipse
     }
 
     template<EventType Type>
-    void EventManager::RegisterEvent(uint32 eventId, sol::function callback)
+    void EventManager::RegisterEvent(uint32 eventId, sol::function callback, uint32 chunkId)
     {
         if (callback.valid())
         {
@@ -77,7 +95,7 @@ namespace Eclipse
             auto& eventList = eventContainer[eventId];
             if (eventList.empty())
                 eventList.reserve(4);
-            eventList.emplace_back(std::move(callback));
+            eventList.emplace_back(std::move(callback), chunkId);
         }
     }
 
@@ -107,11 +125,13 @@ namespace Eclipse
                 const auto& callbacks = it->second;
                 for (const auto& callback : callbacks)
                 {
-                    if (callback.valid())
+                    if (callback.function.valid())
                     {
                         try
                         {
-                            callback(eventId, std::forward<Args>(args)...);
+                            sol::protected_function_result result = callback.function(eventId, std::forward<Args>(args)...);
+                            if (!result.valid())
+                                LogCallbackError(result);
                         }
                         catch (const std::exception&) {}
                     }
@@ -120,6 +140,30 @@ namespace Eclipse
         }
     }
 
+    template<EventType Type, typename... Args>
+    void EventManager::TriggerTypedEvent(uint32 eventId, Args&&... args)
+    {
+        auto& eventContainer = GetEventContainer<Type>();
+
+        const auto it = eventContainer.find(eventId);
+        if (it != eventContainer.end())
+        {
+            for (const auto& callback : it->second)
+            {
+                if (callback.function.valid())
+                {
+                    try
+                    {
+                        sol::protected_function_result result = callback.function(eventId, std::forward<Args>(args)...);
+                        if (!result.valid())
+                            LogCallbackError(result);
+                    }
+                    catch (const std::exception&) {}
+                }
+            }
+        }
+    }
+
     template<typename... Args>
     std::optional<std::any> EventManager::TriggerWithRetValueEvent(uint32 eventId, Args&&... args)
     {
@@ -148,11 +192,11 @@ namespace Eclipse
 
             for (const auto& callback : callbacks)
             {
-                if (callback.valid())
+                if (callback.function.valid())
                 {
                     try
                     {
-                        sol::protected_function_result result = callback(eventId, std::forward<Args>(args)...);
+                        sol::protected_function_result result = callback.function(eventId, std::forward<Args>(args)...);
 
                         if (result.valid())
                         {
@@ -175,6 +219,10 @@ namespace Eclipse
                             }
                             // Add more types as needed
                         }
+                        else
+                        {
+                            LogCallbackError(result);
+                        }
                     }
                     catch (const std::exception&) 
                     {
@@ -219,7 +267,7 @@ namespace Eclipse
     }
 
     template<EventType Type>
-    void EventManager::RegisterKeyedEvent(uint32 objectId, uint32 eventId, sol::function callback)
+    void EventManager::RegisterKeyedEvent(uint32 objectId, uint32 eventId, sol::function callback, uint32 chunkId)
     {
         if (callback.valid())
         {
@@ -228,7 +276,7 @@ namespace Eclipse
             auto& eventList = objectEventMap[eventId];
             if (eventList.empty())
                 eventList.reserve(4);
-            eventList.emplace_back(std::move(callback));
+            eventList.emplace_back(std::move(callback), chunkId);
         }
     }
 
@@ -244,11 +292,13 @@ namespace Eclipse
             {
                 for (auto& callback : eventIt->second)
                 {
-                    if (callback.valid())
+                    if (callback.function.valid())
                     {
                         try
                         {
-                            callback(eventId, std::forward<Args>(args)...);
+                            sol::protected_function_result result = callback.function(eventId, std::forward<Args>(args)...);
+                            if (!result.valid())
+                                LogCallbackError(result);
                         }
                         catch (const std::exception&) {}
                     }
@@ -283,10 +333,40 @@ namespace Eclipse
         return false;
     }
 
+    inline void EventManager::LogCallbackError(const sol::protected_function_result& result)
+    {
+        sol::error error = result;
+        LOG_ERROR("server.eclipse", "[Eclipse]: Error in event handler: {}", error.what());
+    }
+
+    inline void EventManager::ClearChunkEvents(uint32 chunkId)
+    {
+        auto ownedBy = [chunkId](const EventCallback& callback) { return callback.chunkId == chunkId; };
+
+        for (auto& [type, eventContainer] : events)
+        {
+            for (auto& [eventId, callbacks] : eventContainer)
+            {
+                std::erase_if(callbacks, ownedBy);
+            }
+        }
+
+        for (auto& [type, objectContainer] : keyedEvents)
+        {
+            for (auto& [objectId, eventContainer] : objectContainer)
+            {
+                for (auto& [eventId, callbacks] : eventContainer)
+                {
+                    std::erase_if(callbacks, ownedBy);
+                }
+            }
+        }
+    }
+
     template<typename... Args>
     void EventManager::TriggerEventWithRuntimeType(EventType eventType, uint32 eventId, Args&&... args)
     {
-        std::unordered_map<uint32, std::vector<sol::function>>* eventContainer = nullptr;
+        std::unordered_map<uint32, std::vector<EventCallback>>* eventContainer = nullptr;
         switch (eventType)
         {
             case EventType::PLAYER:
@@ -316,11 +396,13 @@ namespace Eclipse
                 const auto& callbacks = it->second;
                 for (const auto& callback : callbacks)
                 {
-                    if (callback.valid())
+                    if (callback.function.valid())
                     {
                         try
                         {
-                            callback(eventId, std::forward<Args>(args)...);
+                            sol::protected_function_result result = callback.function(eventId, std::forward<Args>(args)...);
+                            if (!result.valid())
+                                LogCallbackError(result);
                         }
                         catch (const std::exception&) {}
                     }
@@ -332,7 +414,7 @@ namespace Eclipse
     template<typename... Args>
     std::optional<std::any> EventManager::TriggerWithRetValueEventWithRuntimeType(EventType eventType, uint32 eventId, Args&&... args)
     {
-        std::unordered_map<uint32, std::vector<sol::function>>* eventContainer = nullptr;
+        std::unordered_map<uint32, std::vector<EventCallback>>* eventContainer = nullptr;
 
         switch (eventType)
         {
@@ -370,11 +452,11 @@ namespace Eclipse
 
         for (const auto& callback : callbacks)
         {
-            if (callback.valid())
+            if (callback.function.valid())
             {
                 try
                 {
-                    sol::protected_function_result result = callback(eventId, std::forward<Args>(args)...);
+                    sol::protected_function_result result = callback.function(eventId, std::forward<Args>(args)...);
 
                     if (result.valid())
                     {
@@ -397,6 +479,10 @@ namespace Eclipse
                         }
                         // Add more types as needed
                     }
+                    else
+                    {
+                        LogCallbackError(result);
+                    }
                 }
                 catch (const std::exception&) 
                 {
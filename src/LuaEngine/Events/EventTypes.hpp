@@ -192,7 +192,8 @@ namespace Eclipse
         X(MAP_ON_PLAYER_ENTER,           2) \
         X(MAP_ON_PLAYER_LEAVE,           3) \
         X(MAP_ON_CREATURE_CREATE,        4) \
-        X(MAP_ON_GAMEOBJECT_CREATE,      5)
+        X(MAP_ON_GAMEOBJECT_CREATE,      5) \
+        X(MAP_EVENT_ON_STATE_EVICT,      6)
 
     #define DEFINE_CREATURE_EVENTS(X) \
         X(CREATURE_ON_SPAWN,             1) \
@@ -3,9 +3,13 @@
 
 #include "LuaEngine.hpp"
 #include "MessageManager.hpp"
+#include "TableSnapshots.hpp"
 #include "ObjectGuid.h"
 #include "ObjectAccessor.h"
 
+#include <cmath>
+#include <limits>
+
 namespace Eclipse
 {
     namespace GlobalMethods
@@ -26,19 +30,171 @@ namespace Eclipse
         }
 
         /**
+         * Get the memory used by the current Lua state
+         *
+         * @return uint64 live : bytes currently allocated
+         * @return uint64 peak : highest allocation since the state was created
+         */
+        inline std::tuple<uint64, uint64> GetStateMemoryUsage(LuaEngine* lua)
+        {
+            return { lua->GetMemoryUsage(), lua->GetPeakMemoryUsage() };
+        }
+
+        /**
+         * Get the number of messages waiting for a state
+         *
+         * Messages are handled on the receiving state's own update within a time and
+         * count budget, a growing count means its handlers cannot keep up.
+         *
+         * @param int32 stateId : map ID of the state, -1 for the global state
+         * @return uint64 count
+         */
+        inline uint64 GetStateMessageQueueDepth(LuaEngine* /*lua*/, int32 stateId)
+        {
+            return MessageManager::GetInstance().GetPendingMessageCount(stateId);
+        }
+
+        /**
+         * Get the id of a state message type, the same name has the same id in every state
+         *
+         * Message functions accept the name or the id, the id skips the name lookup.
+         *
+         * @param string messageType
+         * @return uint32 id
+         */
+        inline MessageTypeId GetMessageTypeId(LuaEngine* /*lua*/, const std::string& messageType)
+        {
+            return MessageManager::GetInstance().InternMessageType(messageType);
+        }
+
+        // Message type given by name or by id, 0 if it is neither
+        inline MessageTypeId ResolveMessageType(const sol::object& messageType)
+        {
+            auto& manager = MessageManager::GetInstance();
+            if (messageType.get_type() == sol::type::string)
+                return manager.InternMessageType(messageType.as<std::string>());
+
+            if (messageType.get_type() == sol::type::number)
+            {
+                // Converting 1.5, -1 or 2^32 + 1 would name another type
+                double value = messageType.as<double>();
+                if (value >= 0 && value <= std::numeric_limits<MessageTypeId>::max() && std::trunc(value) == value)
+                {
+                    MessageTypeId id = static_cast<MessageTypeId>(value);
+                    if (manager.IsMessageType(id))
+                        return id;
+                }
+            }
+
+            LOG_ERROR("server.eclipse", "[Eclipse]: Invalid state message type, expected a name or an id from GetMessageTypeId");
+            return 0;
+        }
+
+        /**
+         * Send a message to another state, handled on that state's next update
+         *
+         * @param int32 toStateId : map ID of the state, -1 for the global state
+         * @param string|uint32 messageType : name or id from GetMessageTypeId
+         * @param any data : plain Lua value, see LuaSerializer
+         */
+        inline void SendStateMessage(LuaEngine* lua, int32 toStateId, sol::object messageType, sol::object data)
+        {
+            if (MessageTypeId id = ResolveMessageType(messageType))
+                MessageManager::GetInstance().SendMessage(lua->GetStateMapId(), toStateId, id, data);
+        }
+
+        /**
+         * Publish a message to every state with a handler registered for its type
+         *
+         * The data is encoded once whatever the number of subscribers, each of them
+         * handles it on its own next update. The current state receives it too when it
+         * is subscribed.
+         *
+         * @param string|uint32 messageType : name or id from GetMessageTypeId
+         * @param any data : plain Lua value, see LuaSerializer
+         */
+        inline void PublishStateMessage(LuaEngine* lua, sol::object messageType, sol::object data)
+        {
+            if (MessageTypeId id = ResolveMessageType(messageType))
+                MessageManager::GetInstance().BroadcastMessage(lua->GetStateMapId(), id, data);
+        }
+
+        /**
+         * Send a request to another state and get its reply back
          *
+         * The first value returned by the target's handlers is the reply. The call fails
+         * with an error when the target has no handler for the type, a handler raised an
+         * error or no reply came back in time, and right away when the target is neither
+         * -1 nor a map ("no such state") or its mailbox is full.
+         *
+         *     local call = CallState(-1, "GetTopScores", { limit = 10 })
+         *     call:Then(function(scores, err) ... end)
+         *     -- or, inside a coroutine
+         *     local scores, err = call:Await()
+         *
+         * @param int32 toStateId : map ID of the state, -1 for the global state
+         * @param string|uint32 messageType : name or id from GetMessageTypeId
+         * @param any data : plain Lua value, see LuaSerializer
+         * @param uint32 timeout = Eclipse.Messages.CallTimeout : milliseconds
+         * @return [StateCall] call
          */
-        inline void SendStateMessage(LuaEngine* lua, int32 toStateId, const std::string& messageType, sol::object data)
+        inline std::shared_ptr<StateCall> CallState(LuaEngine* lua, int32 toStateId, sol::object messageType, sol::object data, sol::optional<uint32> timeout)
         {
-            MessageManager::GetInstance().SendMessage(lua->GetStateMapId(), toStateId, messageType, data);
+            MessageTypeId id = ResolveMessageType(messageType);
+            if (!id)
+                return nullptr;
+
+            return lua->CallState(toStateId, id, data, timeout.value_or(0));
         }
 
         /**
+         * Register a handler for messages sent to the current state
          *
+         * @param string|uint32 messageType : name or id from GetMessageTypeId
+         * @param function callback : called with the sender state ID and the data, the
+         *                            value it returns answers a CallState request
          */
-        inline void RegisterStateMessage(LuaEngine* lua, const std::string& messageType, sol::function callback)
+        inline void RegisterStateMessage(LuaEngine* lua, sol::object messageType, sol::function callback)
         {
-            MessageManager::GetInstance().RegisterMessageEvent(lua->GetStateMapId(), messageType, callback);
+            if (MessageTypeId id = ResolveMessageType(messageType))
+                lua->RegisterMessageHandler(id, callback);
+        }
+
+        /**
+         * Build a static table once in the global state and share it with every state
+         *
+         * The global state runs the builder while loading, the returned table is serialized
+         * once all scripts ran. Other states receive a copy instead of running the builder,
+         * which only runs there if no snapshot exists. Only nil, booleans, numbers, strings
+         * and tables can be shared.
+         *
+         * @code {.lua}
+         * local VENDORS = DefineSnapshot("vendors", function()
+         *     return BuildVendorCatalog()
+         * end)
+         * @endcode
+         *
+         * @param string name Unique snapshot name
+         * @param function builder Returns the table
+         * @return table
+         */
+        inline sol::object DefineSnapshot(LuaEngine* lua, const std::string& name, sol::function builder)
+        {
+            lua_State* L = lua->GetState().lua_state();
+            if (lua->GetStateMapId() != -1 && TableSnapshots::GetInstance().Push(L, name, lua->IsStaged()))
+            {
+                return sol::stack::pop<sol::object>(L);
+            }
+
+            sol::object table = builder();
+            if (lua->GetStateMapId() == -1 && table.get_type() == sol::type::table)
+            {
+                table.push(L);
+                TableSnapshots::Mark(L, name, -1);
+                lua_pop(L, 1);
+            }
+
+            return table;
         }
 
         /**
@@ -217,7 +373,7 @@ namespace Eclipse
          */
         inline void RegisterPlayerEvent(LuaEngine* lua, uint32 eventId, sol::function callback)
         {
-            lua->GetEventManager()->RegisterEvent<EventType::PLAYER>(eventId, callback);
+            lua->GetEventManager()->RegisterEvent<EventType::PLAYER>(eventId, callback, lua->GetChunkId(callback));
         }
 
         /**
@@ -233,7 +389,7 @@ namespace Eclipse
          */
         inline void RegisterMapEvent(LuaEngine* lua, uint32 eventId, sol::function callback)
         {
-            lua->GetEventManager()->RegisterEvent<EventType::MAP>(eventId, callback);
+            lua->GetEventManager()->RegisterEvent<EventType::MAP>(eventId, callback, lua->GetChunkId(callback));
         }
 
         /**
@@ -249,7 +405,7 @@ namespace Eclipse
          */
         inline void RegisterCreatureEvent(LuaEngine* lua, uint32 objectId, uint32 eventId, sol::function callback)
         {
-            lua->GetEventManager()->RegisterKeyedEvent<EventType::CREATURE>(objectId, eventId, callback);
+            lua->GetEventManager()->RegisterKeyedEvent<EventType::CREATURE>(objectId, eventId, callback, lua->GetChunkId(callback));
         }
 
         /**
@@ -265,7 +421,7 @@ namespace Eclipse
          */
         inline void RegisterGameObjectEvent(LuaEngine* lua, uint32 objectId, uint32 eventId, sol::function callback)
         {
-            lua->GetEventManager()->RegisterKeyedEvent<EventType::GAMEOBJECT>(objectId, eventId, callback);
+            lua->GetEventManager()->RegisterKeyedEvent<EventType::GAMEOBJECT>(objectId, eventId, callback, lua->GetChunkId(callback));
         }
 
         /**
@@ -281,7 +437,7 @@ namespace Eclipse
          */
         inline void RegisterItemEvent(LuaEngine* lua, uint32 objectId, uint32 eventId, sol::function callback)
         {
-            lua->GetEventManager()->RegisterKeyedEvent<EventType::ITEM>(objectId, eventId, callback);
+            lua->GetEventManager()->RegisterKeyedEvent<EventType::ITEM>(objectId, eventId, callback, lua->GetChunkId(callback));
         }
 
         /**
@@ -378,6 +534,8 @@ namespace Eclipse
         {
             // Getters
             lua["GetStateMapId"] = Bind(&GetStateMapId, lua_engine);
+            lua["GetStateMemoryUsage"] = Bind(&GetStateMemoryUsage, lua_engine);
+            lua["GetStateMessageQueueDepth"] = Bind(&GetStateMessageQueueDepth, lua_engine);
             lua["GetSpawnedCreatureByDBGUID"] = Bind(&GetSpawnedCreatureByDBGUID, lua_engine);
             lua["GetSpawnedGameObjectByDBGUID"] = Bind(&GetSpawnedGameObjectByDBGUID, lua_engine);
             lua["GetPlayers"] = Bind(&GetPlayers, lua_engine);
@@ -390,8 +548,12 @@ namespace Eclipse
             // Booleans
 
             // Actions
+            lua["GetMessageTypeId"] = Bind(&GetMessageTypeId, lua_engine);
             lua["RegisterStateMessage"] = Bind(&RegisterStateMessage, lua_engine);
             lua["SendStateMessage"] = Bind(&SendStateMessage, lua_engine);
+            lua["PublishStateMessage"] = Bind(&PublishStateMessage, lua_engine);
+            lua["CallState"] = Bind(&CallState, lua_engine);
+            lua["DefineSnapshot"] = Bind(&DefineSnapshot, lua_engine);
             lua["RegisterPlayerEvent"] = Bind(&RegisterPlayerEvent, lua_engine);
             lua["ClearPlayerEvents"] = Bind(&ClearPlayerEvents, lua_engine);
             lua["RegisterMapEvent"] = Bind(&RegisterMapEvent, lua_engine);
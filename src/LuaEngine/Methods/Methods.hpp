@@ -6,6 +6,7 @@
 #include "PlayerMethods.hpp"
 #include "GlobalMethods.hpp"
 #include "ObjectGuidMethods.hpp"
+#include "StateCallMethods.hpp"
 
 namespace Eclipse
 {
@@ -46,6 +47,9 @@ namespace Eclipse
             auto objectguid_type = lua.new_usertype<ObjectGuid>("ObjectGuid");
             ObjectGuidMethods::RegisterObjectGuidMethods(objectguid_type);
 
+            auto statecall_type = lua.new_usertype<StateCall>("StateCall", sol::no_constructor);
+            StateCallMethods::RegisterStateCallMethods(statecall_type);
+
             Eclipse::RegisterEventKeysToLua(lua);
         }
     }
@@ -0,0 +1,83 @@
+#ifndef ECLIPSE_STATE_CALL_METHODS_HPP
+#define ECLIPSE_STATE_CALL_METHODS_HPP
+
+#include "EclipseIncludes.hpp"
+#include "StateCall.hpp"
+
+namespace Eclipse
+{
+    namespace StateCallMethods
+    {
+        /**
+         * Check if the reply arrived or the call failed
+         */
+        inline bool IsDone(StateCall* call)
+        {
+            return call->IsDone();
+        }
+
+        /**
+         * Get the result of a finished call
+         *
+         * @return any value : first value returned by the target's handlers, nil on failure
+         * @return string error : nil on success
+         */
+        inline std::tuple<sol::object, sol::object> GetResult(StateCall* call)
+        {
+            return { call->GetValue(), call->GetError() };
+        }
+
+        /**
+         * Call a function with (value, error) once the call is done, immediately if it already is
+         */
+        inline void Then(StateCall* call, sol::function callback)
+        {
+            call->Then(std::move(callback));
+        }
+
+        /**
+         * Suspend the running coroutine until the call is done, it resumes on a later update
+         * of the current state
+         *
+         * @return any value
+         * @return string error
+         */
+        inline int Await(lua_State* L)
+        {
+            StateCall* call = sol::stack::check<StateCall*>(L, 1, sol::no_panic) ? sol::stack::get<StateCall*>(L, 1) : nullptr;
+            if (!call)
+                return luaL_error(L, "StateCall:Await expects a StateCall");
+
+            if (call->IsDone())
+            {
+                call->GetValue().push(L);
+                call->GetError().push(L);
+                return 2;
+            }
+
+            // The main thread cannot yield
+            if (lua_pushthread(L))
+            {
+                lua_pop(L, 1);
+                return luaL_error(L, "StateCall:Await must be called from a coroutine, use Then instead");
+            }
+            lua_pop(L, 1);
+
+            call->Await(L);
+            return lua_yield(L, 0);
+        }
+
+        // ========== REGISTRATION ==========
+
+        template<typename T>
+        void RegisterStateCallMethods(sol::usertype<T>& type)
+        {
+            type["IsDone"] = &IsDone;
+            type["GetResult"] = &GetResult;
+            type["Then"] = &Then;
+            type["Await"] = &Await;
+        }
+    }
+}
+
+#endif // ECLIPSE_STATE_CALL_METHODS_HPP
@@ -0,0 +1,42 @@
+#ifndef ECLIPSE_BYTECODE_BUFFER_HPP
+#define ECLIPSE_BYTECODE_BUFFER_HPP
+
+#include <memory>
+#include <vector>
+
+namespace Eclipse
+{
+    // Compiled chunk shared read-only by every state that executes it
+    class BytecodeBuffer
+    {
+    public:
+        explicit BytecodeBuffer(std::vector<char>&& bytecode)
+            : storage(std::move(bytecode)), data(storage.data()), size(storage.size()) {}
+
+        // Borrows memory kept alive by keepAlive, e.g. a slice of a mapped script pack
+        BytecodeBuffer(const char* external, size_t length, std::shared_ptr<const void> keepAlive)
+            : data(external), size(length), owner(std::move(keepAlive)) {}
+
+        BytecodeBuffer(const BytecodeBuffer&) = delete;
+        BytecodeBuffer& operator=(const BytecodeBuffer&) = delete;
+
+        const char* Data() const { return data; }
+        size_t Size() const { return size; }
+        bool Empty() const { return size == 0; }
+
+    private:
+        const std::vector<char> storage;
+        const char* const data;
+        const size_t size;
+        const std::shared_ptr<const void> owner;
+    };
+
+    using BytecodeRef = std::shared_ptr<const BytecodeBuffer>;
+
+    inline BytecodeRef MakeBytecode(std::vector<char>&& data)
+    {
+        return std::make_shared<const BytecodeBuffer>(std::move(data));
+    }
+}
+
+#endif // ECLIPSE_BYTECODE_BUFFER_HPP
@@ -0,0 +1,140 @@
+#include "BytecodeDiskCache.hpp"
+#include "ContentHash.hpp"
+#include "EclipseConfig.hpp"
+#include "LuaAbi.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+namespace Eclipse
+{
+    BytecodeDiskCache& BytecodeDiskCache::GetInstance()
+    {
+        static BytecodeDiskCache instance;
+        return instance;
+    }
+
+    bool BytecodeDiskCache::IsEnabled() const
+    {
+        return EclipseConfig::GetInstance().IsBytecodeCacheEnabled();
+    }
+
+    uint64 BytecodeDiskCache::ComputeKey(const std::string& filePath, const std::string& source, bool strip)
+    {
+        // The path is part of the key since it is embedded in the bytecode as chunk name
+        uint64 seed = ContentHash::Compute(GetLuaAbiTag(), strip ? 1 : 0);
+        seed = ContentHash::Compute(filePath, seed);
+        return ContentHash::Compute(source, seed);
+    }
+
+    std::string BytecodeDiskCache::GetEntryPath(uint64 key, const char* extension) const
+    {
+        std::filesystem::path directory(std::string(EclipseConfig::GetInstance().GetBytecodeCachePath()));
+        return (directory / fmt::format("{:016x}{}", key, extension)).string();
+    }
+
+    std::optional<std::vector<char>> BytecodeDiskCache::Load(const std::string& filePath, const std::string& source, bool strip) const
+    {
+        if (!IsEnabled())
+            return std::nullopt;
+
+        return ReadEntry(ComputeKey(filePath, source, strip), ".bc", filePath);
+    }
+
+    void BytecodeDiskCache::Store(const std::string& filePath, const std::string& source, const std::vector<char>& bytecode, bool strip) const
+    {
+        if (!IsEnabled() || bytecode.empty())
+            return;
+
+        WriteEntry(ComputeKey(filePath, source, strip), ".bc", bytecode.data(), bytecode.size(), filePath);
+    }
+
+    std::optional<std::string> BytecodeDiskCache::LoadTranslation(const std::string& filePath, const std::string& source, const std::string& compilerVersion) const
+    {
+        if (!IsEnabled())
+            return std::nullopt;
+
+        auto luaSource = ReadEntry(ContentHash::Compute(source, ContentHash::Compute(compilerVersion)), ".moon.lua", filePath);
+        if (!luaSource)
+            return std::nullopt;
+
+        return std::string(luaSource->begin(), luaSource->end());
+    }
+
+    void BytecodeDiskCache::StoreTranslation(const std::string& filePath, const std::string& source, const std::string& compilerVersion, const std::string& luaSource) const
+    {
+        if (!IsEnabled() || luaSource.empty())
+            return;
+
+        WriteEntry(ContentHash::Compute(source, ContentHash::Compute(compilerVersion)), ".moon.lua", luaSource.data(), luaSource.size(), filePath);
+    }
+
+    std::optional<std::vector<char>> BytecodeDiskCache::ReadEntry(uint64 key, const char* extension, const std::string& filePath) const
+    {
+        std::string entryPath = GetEntryPath(key, extension);
+        std::ifstream file(entryPath, std::ios::binary);
+        if (!file.is_open())
+            return std::nullopt;
+
+        std::error_code ec;
+        uint64 fileSize = std::filesystem::file_size(entryPath, ec);
+        if (ec || fileSize < sizeof(EntryHeader))
+            return std::nullopt;
+
+        EntryHeader header{};
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+            return std::nullopt;
+
+        // A truncated or corrupt size must not reach the allocation below
+        if (header.magic != ENTRY_MAGIC || header.version != ENTRY_VERSION || header.key != key || header.payloadSize > fileSize - sizeof(header))
+        {
+            LOG_DEBUG("server.eclipse", "[Eclipse]: Ignoring invalid cache entry for {}", filePath);
+            return std::nullopt;
+        }
+
+        std::vector<char> payload(header.payloadSize);
+        if (!file.read(payload.data(), payload.size()) || ContentHash::Compute(payload.data(), payload.size()) != header.payloadHash)
+        {
+            LOG_DEBUG("server.eclipse", "[Eclipse]: Ignoring corrupt cache entry for {}", filePath);
+            return std::nullopt;
+        }
+
+        return payload;
+    }
+
+    void BytecodeDiskCache::WriteEntry(uint64 key, const char* extension, const char* data, size_t size, const std::string& filePath) const
+    {
+        std::filesystem::path entryPath(GetEntryPath(key, extension));
+
+        std::error_code ec;
+        std::filesystem::create_directories(entryPath.parent_path(), ec);
+
+        // Written under a per-thread name then renamed, readers never see a partial entry
+        std::filesystem::path tempPath = entryPath;
+        tempPath += fmt::format(".{:x}.tmp", std::hash<std::thread::id>{}(std::this_thread::get_id()));
+
+        EntryHeader header{ ENTRY_MAGIC, ENTRY_VERSION, key, size, ContentHash::Compute(data, size) };
+
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(data, size);
+            if (!file)
+            {
+                file.close();
+                std::filesystem::remove(tempPath, ec);
+                LOG_WARN("server.eclipse", "[Eclipse]: Failed to write cache entry for {}", filePath);
+                return;
+            }
+        }
+
+        std::filesystem::rename(tempPath, entryPath, ec);
+        if (ec)
+        {
+            std::filesystem::remove(tempPath, ec);
+            LOG_WARN("server.eclipse", "[Eclipse]: Failed to publish cache entry for {}", filePath);
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef ECLIPSE_BYTECODE_DISK_CACHE_HPP
+#define ECLIPSE_BYTECODE_DISK_CACHE_HPP
+
+#include "EclipseIncludes.hpp"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Eclipse
+{
+    // Persistent bytecode cache shared by all compiler states. Entries are keyed by
+    // script path, source content, Lua ABI and strip setting, so a stale or foreign
+    // entry is never found rather than having to be detected. MoonScript translations
+    // are kept alongside, so a bytecode miss does not run the MoonScript compiler again.
+    class BytecodeDiskCache
+    {
+    public:
+        static BytecodeDiskCache& GetInstance();
+
+        std::optional<std::vector<char>> Load(const std::string& filePath, const std::string& source, bool strip = false) const;
+        void Store(const std::string& filePath, const std::string& source, const std::vector<char>& bytecode, bool strip = false) const;
+
+        // MoonScript output, keyed by source and compiler version only
+        std::optional<std::string> LoadTranslation(const std::string& filePath, const std::string& source, const std::string& compilerVersion) const;
+        void StoreTranslation(const std::string& filePath, const std::string& source, const std::string& compilerVersion, const std::string& luaSource) const;
+
+        bool IsEnabled() const;
+
+    private:
+        static constexpr uint32 ENTRY_MAGIC = 0x43424345; // "ECBC"
+        static constexpr uint32 ENTRY_VERSION = 1;
+
+        struct EntryHeader
+        {
+            uint32 magic;
+            uint32 version;
+            uint64 key;
+            uint64 payloadSize;
+            uint64 payloadHash;
+        };
+
+        BytecodeDiskCache() = default;
+        ~BytecodeDiskCache() = default;
+        BytecodeDiskCache(const BytecodeDiskCache&) = delete;
+        BytecodeDiskCache& operator=(const BytecodeDiskCache&) = delete;
+
+        static uint64 ComputeKey(const std::string& filePath, const std::string& source, bool strip);
+        std::string GetEntryPath(uint64 key, const char* extension) const;
+
+        std::optional<std::vector<char>> ReadEntry(uint64 key, const char* extension, const std::string& filePath) const;
+        void WriteEntry(uint64 key, const char* extension, const char* data, size_t size, const std::string& filePath) const;
+    };
+}
+
+#endif // ECLIPSE_BYTECODE_DISK_CACHE_HPP
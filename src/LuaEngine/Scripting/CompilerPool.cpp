@@ -0,0 +1,141 @@
+#include "CompilerPool.hpp"
+#include "LuaCompiler.hpp"
+#include "LuaEngine.hpp"
+#include "EclipseConfig.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace Eclipse
+{
+    CompilerPool& CompilerPool::GetInstance()
+    {
+        static CompilerPool instance;
+        return instance;
+    }
+
+    size_t CompilerPool::GetConfiguredWorkerCount()
+    {
+        size_t count = EclipseConfig::GetInstance().GetCompileThreads();
+        if (!count)
+            count = std::thread::hardware_concurrency();
+
+        return std::max<size_t>(count, 1);
+    }
+
+    void CompilerPool::EnsureWorkerStates(size_t count)
+    {
+        // Created on the calling thread, under compileMutex
+        while (workerStates.size() < count)
+        {
+            workerStates.emplace_back(LuaEngine::CreateCompilerState());
+        }
+    }
+
+    std::vector<std::vector<char>> CompilerPool::CompileAll(const std::vector<std::string>& files, std::vector<FileFingerprint>& fingerprints)
+    {
+        std::vector<std::vector<char>> results(files.size());
+        fingerprints.assign(files.size(), FileFingerprint{});
+        if (files.empty())
+            return results;
+
+        std::lock_guard<std::mutex> lock(compileMutex);
+
+        size_t workerCount = std::min(GetConfiguredWorkerCount(), files.size());
+        EnsureWorkerStates(workerCount);
+
+        std::atomic<size_t> nextFile{ 0 };
+        auto compile = [&](sol::state& compilerState)
+        {
+            for (size_t i = nextFile.fetch_add(1, std::memory_order_relaxed); i < files.size(); i = nextFile.fetch_add(1, std::memory_order_relaxed))
+            {
+                results[i] = LuaCompiler::CompileFileTobytecode(compilerState, files[i], fingerprints[i]);
+            }
+        };
+
+        std::vector<std::thread> workers;
+        workers.reserve(workerCount - 1);
+        for (size_t i = 1; i < workerCount; ++i)
+        {
+            workers.emplace_back(compile, std::ref(*workerStates[i]));
+        }
+
+        // The calling thread is the first worker
+        compile(*workerStates[0]);
+
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+
+        return results;
+    }
+
+    std::unique_ptr<CompileStream> CompilerPool::StartStream(BoundedQueue<ScriptSource>& input, BoundedQueue<CompiledSource>& output, size_t expected)
+    {
+        auto stream = std::make_unique<CompileStream>();
+        stream->poolLock = std::unique_lock<std::mutex>(compileMutex);
+
+        size_t workerCount = std::min(GetConfiguredWorkerCount(), std::max<size_t>(expected, 1));
+        EnsureWorkerStates(workerCount);
+
+        auto remaining = std::make_shared<std::atomic<size_t>>(workerCount);
+        stream->workerTimes.assign(workerCount, 0);
+
+        auto compile = [&input, &output, remaining](sol::state& compilerState, uint64& workerTime)
+        {
+            while (auto source = input.Pop())
+            {
+                auto startTime = std::chrono::high_resolution_clock::now();
+
+                CompiledSource compiled;
+                compiled.index = source->index;
+                compiled.fingerprint = source->fingerprint;
+                compiled.missing = source->missing;
+                if (!source->missing)
+                    compiled.bytecode = LuaCompiler::CompileSourceTobytecode(compilerState, source->path, std::move(source->content));
+
+                workerTime += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+                if (!output.Push(std::move(compiled)))
+                    break;
+            }
+
+            // The last worker out tells the consumer nothing else is coming
+            if (remaining->fetch_sub(1, std::memory_order_acq_rel) == 1)
+                output.Close();
+        };
+
+        stream->workers.reserve(workerCount);
+        for (size_t i = 0; i < workerCount; ++i)
+        {
+            stream->workers.emplace_back(compile, std::ref(*workerStates[i]), std::ref(stream->workerTimes[i]));
+        }
+
+        return stream;
+    }
+
+    void CompileStream::Join()
+    {
+        for (auto& worker : workers)
+        {
+            if (worker.joinable())
+                worker.join();
+        }
+
+        busyTime = 0;
+        for (uint64 workerTime : workerTimes)
+            busyTime += workerTime;
+
+        if (poolLock.owns_lock())
+            poolLock.unlock();
+    }
+
+    void CompilerPool::Shutdown()
+    {
+        std::lock_guard<std::mutex> lock(compileMutex);
+        workerStates.clear();
+    }
+}
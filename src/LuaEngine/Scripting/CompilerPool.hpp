@@ -0,0 +1,87 @@
+#ifndef ECLIPSE_COMPILER_POOL_HPP
+#define ECLIPSE_COMPILER_POOL_HPP
+
+#include "EclipseIncludes.hpp"
+#include "BoundedQueue.hpp"
+#include "FileFingerprint.hpp"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Eclipse
+{
+    // Script read by the I/O stage of a pipelined load
+    struct ScriptSource
+    {
+        size_t index = 0;
+        std::string path;
+        std::string content;
+        FileFingerprint fingerprint;
+        bool missing = false;
+    };
+
+    // Result of the compile stage, bytecode is empty when compilation failed
+    struct CompiledSource
+    {
+        size_t index = 0;
+        std::vector<char> bytecode;
+        FileFingerprint fingerprint;
+        bool missing = false;
+    };
+
+    // Workers of a running stream, the pool stays reserved until Join
+    class CompileStream
+    {
+    public:
+        ~CompileStream() { Join(); }
+
+        void Join();
+
+        // Summed over workers, in microseconds; valid after Join
+        uint64 GetBusyTime() const { return busyTime; }
+
+    private:
+        friend class CompilerPool;
+
+        std::unique_lock<std::mutex> poolLock;
+        std::vector<std::thread> workers;
+        uint64 busyTime = 0;
+        std::vector<uint64> workerTimes;
+    };
+
+    // Compiles scripts in parallel. Each worker owns a compiler state for the lifetime
+    // of the pool, so modules such as MoonScript are only loaded once per worker.
+    class CompilerPool
+    {
+    public:
+        static CompilerPool& GetInstance();
+
+        // result[i] is the bytecode of files[i], empty when compilation failed, and
+        // fingerprints[i] the fingerprint of the source it was compiled from
+        std::vector<std::vector<char>> CompileAll(const std::vector<std::string>& files, std::vector<FileFingerprint>& fingerprints);
+
+        // Compiles sources popped from input on worker threads and closes output once input
+        // is closed and drained. Returns immediately, the calling thread stays free to consume.
+        std::unique_ptr<CompileStream> StartStream(BoundedQueue<ScriptSource>& input, BoundedQueue<CompiledSource>& output, size_t expected);
+
+        void Shutdown();
+
+    private:
+        CompilerPool() = default;
+        ~CompilerPool() = default;
+        CompilerPool(const CompilerPool&) = delete;
+        CompilerPool& operator=(const CompilerPool&) = delete;
+
+        // Serializes batches, the world thread and the background reload may both compile
+        std::mutex compileMutex;
+        std::vector<std::unique_ptr<sol::state>> workerStates;
+
+        static size_t GetConfiguredWorkerCount();
+        void EnsureWorkerStates(size_t count);
+    };
+}
+
+#endif // ECLIPSE_COMPILER_POOL_HPP
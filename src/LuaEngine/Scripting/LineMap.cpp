@@ -0,0 +1,255 @@
+#include "LineMap.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+namespace Eclipse
+{
+    namespace
+    {
+        struct Token
+        {
+            bool isName;
+            std::string text;
+            int32 line;
+        };
+
+        // Level of the long bracket opening at pos ("[[", "[==["), -1 if there is none
+        int32 LongBracketLevel(const std::string& source, size_t pos)
+        {
+            if (pos >= source.size() || source[pos] != '[')
+                return -1;
+
+            size_t end = pos + 1;
+            while (end < source.size() && source[end] == '=')
+                ++end;
+
+            return end < source.size() && source[end] == '[' ? static_cast<int32>(end - pos - 1) : -1;
+        }
+
+        size_t SkipLongBracket(const std::string& source, size_t pos, int32 level, int32& line)
+        {
+            std::string closing = "]" + std::string(level, '=') + "]";
+            size_t end = source.find(closing, pos + level + 2);
+            end = end == std::string::npos ? source.size() : end + closing.size();
+
+            for (size_t i = pos; i < end; ++i)
+            {
+                if (source[i] == '\n')
+                    ++line;
+            }
+
+            return end;
+        }
+
+        // Names and single punctuation characters, strings, numbers and comments are dropped
+        std::vector<Token> Tokenize(const std::string& source)
+        {
+            std::vector<Token> tokens;
+            int32 line = 1;
+            size_t i = 0;
+
+            while (i < source.size())
+            {
+                char c = source[i];
+
+                if (c == '\n')
+                {
+                    ++line;
+                    ++i;
+                }
+                else if (std::isspace(static_cast<unsigned char>(c)))
+                {
+                    ++i;
+                }
+                else if (c == '-' && i + 1 < source.size() && source[i + 1] == '-')
+                {
+                    int32 level = LongBracketLevel(source, i + 2);
+                    if (level >= 0)
+                        i = SkipLongBracket(source, i + 2, level, line);
+                    else
+                        i = std::min(source.find('\n', i), source.size());
+                }
+                else if (c == '[' && LongBracketLevel(source, i) >= 0)
+                {
+                    i = SkipLongBracket(source, i, LongBracketLevel(source, i), line);
+                }
+                else if (c == '"' || c == '\'')
+                {
+                    for (++i; i < source.size() && source[i] != c; ++i)
+                    {
+                        if (source[i] == '\\' && i + 1 < source.size())
+                            ++i;
+                        if (source[i] == '\n')
+                            ++line;
+                    }
+                    ++i;
+                }
+                else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_')
+                {
+                    size_t start = i;
+                    while (i < source.size() && (std::isalnum(static_cast<unsigned char>(source[i])) || source[i] == '_'))
+                        ++i;
+                    tokens.push_back({ true, source.substr(start, i - start), line });
+                }
+                else if (std::isdigit(static_cast<unsigned char>(c)))
+                {
+                    while (i < source.size() && (std::isalnum(static_cast<unsigned char>(source[i])) || source[i] == '.'))
+                        ++i;
+                }
+                else
+                {
+                    tokens.push_back({ false, std::string(1, c), line });
+                    ++i;
+                }
+            }
+
+            return tokens;
+        }
+
+        bool Is(const std::vector<Token>& tokens, size_t index, const char* text)
+        {
+            return index < tokens.size() && tokens[index].text == text;
+        }
+
+        bool IsName(const std::vector<Token>& tokens, size_t index)
+        {
+            return index < tokens.size() && tokens[index].isName;
+        }
+    }
+
+    LineMap& LineMap::GetInstance()
+    {
+        static LineMap instance;
+        return instance;
+    }
+
+    std::vector<FunctionRange> LineMap::Scan(const std::string& luaSource)
+    {
+        std::vector<Token> tokens = Tokenize(luaSource);
+        std::vector<FunctionRange> functions;
+
+        // Blocks closed by `end`: functions are indexes into functions, other blocks -1
+        std::vector<int32> blocks;
+
+        for (size_t i = 0; i < tokens.size(); ++i)
+        {
+            const Token& token = tokens[i];
+            if (!token.isName)
+                continue;
+
+            if (token.text == "function")
+            {
+                FunctionRange function;
+                function.firstLine = token.line;
+
+                size_t next = i + 1;
+                if (IsName(tokens, next))
+                {
+                    function.name = tokens[next++].text;
+                    while ((Is(tokens, next, ".") || Is(tokens, next, ":")) && IsName(tokens, next + 1))
+                    {
+                        function.name += tokens[next].text + tokens[next + 1].text;
+                        next += 2;
+                    }
+                }
+                else if (i >= 2 && Is(tokens, i - 1, "=") && IsName(tokens, i - 2))
+                {
+                    function.name = tokens[i - 2].text;
+                }
+                else
+                {
+                    function.name = "anonymous";
+                }
+
+                if (Is(tokens, next, "("))
+                {
+                    for (++next; next < tokens.size() && !Is(tokens, next, ")"); ++next)
+                    {
+                        if (tokens[next].isName)
+                            function.parameters.push_back(tokens[next].text);
+                        else if (Is(tokens, next, ".") && Is(tokens, next + 1, ".") && Is(tokens, next + 2, "."))
+                        {
+                            function.parameters.push_back("...");
+                            next += 2;
+                        }
+                    }
+                }
+
+                blocks.push_back(static_cast<int32>(functions.size()));
+                functions.push_back(std::move(function));
+            }
+            else if (token.text == "do" || token.text == "if")
+            {
+                // `while`/`for` open with their `do`, `then`/`elseif`/`else` share the `if` block
+                blocks.push_back(-1);
+            }
+            else if (token.text == "end" && !blocks.empty())
+            {
+                if (blocks.back() >= 0)
+                    functions[blocks.back()].lastLine = token.line;
+                blocks.pop_back();
+            }
+        }
+
+        return functions;
+    }
+
+    void LineMap::Store(const std::string& chunkName, std::vector<FunctionRange>&& functions)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        chunks.insert_or_assign(chunkName, std::move(functions));
+    }
+
+    void LineMap::Remove(const std::string& chunkName)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        chunks.erase(chunkName);
+    }
+
+    const FunctionRange* LineMap::Find(const std::vector<FunctionRange>& functions, int32 firstLine, int32 lastLine)
+    {
+        for (const auto& function : functions)
+        {
+            if (function.firstLine == firstLine && function.lastLine == lastLine)
+                return &function;
+        }
+
+        return nullptr;
+    }
+
+    std::string LineMap::Format(const std::string& chunkName, const FunctionRange& function)
+    {
+        std::string parameters;
+        for (const auto& parameter : function.parameters)
+            parameters += (parameters.empty() ? "" : ", ") + parameter;
+
+        return fmt::format("{}:{}-{} in function {}({})", chunkName, function.firstLine, function.lastLine, function.name, parameters);
+    }
+
+    std::string LineMap::Resolve(const std::string& chunkHint, int32 firstLine, int32 lastLine) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto hinted = chunks.find(chunkHint);
+        if (hinted != chunks.end())
+        {
+            if (const FunctionRange* function = Find(hinted->second, firstLine, lastLine))
+                return Format(chunkHint, *function);
+        }
+
+        // Functions called across scripts: only an unambiguous match is reported
+        std::string resolved;
+        for (const auto& [chunkName, functions] : chunks)
+        {
+            if (const FunctionRange* function = Find(functions, firstLine, lastLine))
+            {
+                if (!resolved.empty())
+                    return "";
+                resolved = Format(chunkName, *function);
+            }
+        }
+
+        return resolved;
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef ECLIPSE_LINE_MAP_HPP
+#define ECLIPSE_LINE_MAP_HPP
+
+#include "EclipseIncludes.hpp"
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Eclipse
+{
+    struct FunctionRange
+    {
+        int32 firstLine = 0;
+        int32 lastLine = 0;
+        std::string name;
+        std::vector<std::string> parameters;
+    };
+
+    // Function line ranges of scripts compiled without debug information. Stripped
+    // bytecode keeps linedefined/lastlinedefined only, this maps them back to the
+    // script and function they belong to when an error is reported.
+    class LineMap
+    {
+    public:
+        static LineMap& GetInstance();
+
+        // Scans Lua source for function definitions, no parser state is needed
+        static std::vector<FunctionRange> Scan(const std::string& luaSource);
+
+        void Store(const std::string& chunkName, std::vector<FunctionRange>&& functions);
+        void Remove(const std::string& chunkName);
+
+        // "file:first-last in function name(params)", the hint chunk is searched first;
+        // empty if no single script defines a function with this range
+        std::string Resolve(const std::string& chunkHint, int32 firstLine, int32 lastLine) const;
+
+    private:
+        LineMap() = default;
+        ~LineMap() = default;
+        LineMap(const LineMap&) = delete;
+        LineMap& operator=(const LineMap&) = delete;
+
+        static const FunctionRange* Find(const std::vector<FunctionRange>& functions, int32 firstLine, int32 lastLine);
+        static std::string Format(const std::string& chunkName, const FunctionRange& function);
+
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, std::vector<FunctionRange>> chunks;
+    };
+}
+
+#endif // ECLIPSE_LINE_MAP_HPP
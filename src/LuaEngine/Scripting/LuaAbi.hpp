@@ -0,0 +1,33 @@
+#ifndef ECLIPSE_LUA_ABI_HPP
+#define ECLIPSE_LUA_ABI_HPP
+
+#include "lua.hpp"
+
+#include <string>
+
+namespace Eclipse
+{
+    // Identifies the Lua build, bytecode is only portable between identical ones.
+    // Shared with eclipse-luac, so it must not depend on the core.
+    inline const std::string& GetLuaAbiTag()
+    {
+        static const std::string tag = []()
+        {
+#ifdef LUAJIT_VERSION_NUM
+            std::string abi = "LuaJIT " + std::to_string(LUAJIT_VERSION_NUM);
+#else
+            std::string abi = LUA_RELEASE;
+#endif
+            abi += "/ptr" + std::to_string(sizeof(void*));
+            abi += "/num" + std::to_string(sizeof(lua_Number));
+#if LUA_VERSION_NUM >= 503
+            abi += "/int" + std::to_string(sizeof(lua_Integer));
+#endif
+            return abi;
+        }();
+
+        return tag;
+    }
+}
+
+#endif // ECLIPSE_LUA_ABI_HPP
@@ -0,0 +1,150 @@
+#include "LuaAllocator.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace Eclipse
+{
+    LuaAllocator::~LuaAllocator()
+    {
+        for (void* page : pages)
+            std::free(page);
+    }
+
+    void* LuaAllocator::Allocate(void* ud, void* ptr, size_t osize, size_t nsize)
+    {
+        return static_cast<LuaAllocator*>(ud)->Reallocate(ptr, osize, nsize);
+    }
+
+    void LuaAllocator::SetLimits(size_t softBytes, size_t hardBytes)
+    {
+        softLimit = softBytes;
+        hardLimit = hardBytes;
+    }
+
+    bool LuaAllocator::ConsumeSoftLimitReached()
+    {
+        if (!softLimitReached)
+            return false;
+
+        softLimitReached = false;
+        return true;
+    }
+
+    void* LuaAllocator::Reallocate(void* ptr, size_t osize, size_t nsize)
+    {
+        // With a NULL block, osize carries the object type (5.2+), not a size
+        size_t oldSize = ptr ? osize : 0;
+
+        if (nsize == 0)
+        {
+            if (ptr)
+            {
+                if (IsSmall(oldSize))
+                    ReleaseSmall(ptr, oldSize);
+                else
+                    std::free(ptr);
+
+                UpdateLiveBytes(oldSize, 0);
+            }
+            return nullptr;
+        }
+
+        // Shrinking must never fail, only growth is checked against the hard limit
+        if (hardLimit && nsize > oldSize && GetLiveBytes() - oldSize + nsize > hardLimit)
+        {
+            if (!hardLimitReported)
+            {
+                hardLimitReported = true;
+                LOG_ERROR("server.eclipse", "[Eclipse]: State {} hit its hard memory limit ({} KB live, {} KB limit)",
+                    ownerStateId, GetLiveBytes() / 1024, hardLimit / 1024);
+            }
+            return nullptr;
+        }
+
+        void* block = nullptr;
+        if (ptr && IsSmall(oldSize) && IsSmall(nsize) && GetSizeClass(oldSize) == GetSizeClass(nsize))
+        {
+            block = ptr;
+        }
+        else if (ptr && !IsSmall(oldSize) && !IsSmall(nsize))
+        {
+            block = std::realloc(ptr, nsize);
+            if (!block)
+                return nullptr;
+        }
+        else
+        {
+            block = IsSmall(nsize) ? AcquireSmall(nsize) : std::malloc(nsize);
+            if (!block)
+                return nullptr;
+
+            if (ptr)
+            {
+                std::memcpy(block, ptr, std::min(oldSize, nsize));
+                if (IsSmall(oldSize))
+                    ReleaseSmall(ptr, oldSize);
+                else
+                    std::free(ptr);
+            }
+        }
+
+        UpdateLiveBytes(oldSize, nsize);
+        return block;
+    }
+
+    void* LuaAllocator::AcquireSmall(size_t size)
+    {
+        size_t sizeClass = GetSizeClass(size);
+        if (FreeBlock* block = freeLists[sizeClass])
+        {
+            freeLists[sizeClass] = block->next;
+            return block;
+        }
+
+        size_t blockSize = (sizeClass + 1) * SIZE_CLASS_GRANULARITY;
+        if (pageRemaining < blockSize)
+        {
+            // The tail of the previous page is too small for this class and is left unused
+            void* page = std::malloc(PAGE_SIZE);
+            if (!page)
+                return nullptr;
+
+            pages.push_back(page);
+            pageCursor = static_cast<char*>(page);
+            pageRemaining = PAGE_SIZE;
+        }
+
+        void* block = pageCursor;
+        pageCursor += blockSize;
+        pageRemaining -= blockSize;
+        return block;
+    }
+
+    void LuaAllocator::ReleaseSmall(void* ptr, size_t size)
+    {
+        size_t sizeClass = GetSizeClass(size);
+        FreeBlock* block = static_cast<FreeBlock*>(ptr);
+        block->next = freeLists[sizeClass];
+        freeLists[sizeClass] = block;
+    }
+
+    void LuaAllocator::UpdateLiveBytes(size_t oldSize, size_t newSize)
+    {
+        size_t live = liveBytes.load(std::memory_order_relaxed) - oldSize + newSize;
+        liveBytes.store(live, std::memory_order_relaxed);
+
+        if (live > peakBytes.load(std::memory_order_relaxed))
+            peakBytes.store(live, std::memory_order_relaxed);
+
+        // Signal only on the transition above the soft limit, not on every allocation past it
+        bool overSoft = softLimit && live > softLimit;
+        if (overSoft && !overSoftLimit)
+            softLimitReached = true;
+        overSoftLimit = overSoft;
+
+        if (hardLimitReported && live < hardLimit / 4 * 3)
+            hardLimitReported = false;
+    }
+}
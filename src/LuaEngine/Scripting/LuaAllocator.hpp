@@ -0,0 +1,75 @@
+#ifndef ECLIPSE_LUA_ALLOCATOR_HPP
+#define ECLIPSE_LUA_ALLOCATOR_HPP
+
+#include "EclipseIncludes.hpp"
+
+#include <array>
+#include <atomic>
+#include <vector>
+
+namespace Eclipse
+{
+    // Per-state lua_Alloc backed by size-class pools. A state is only used by the
+    // thread updating its map, so the pools are unsynchronized and small blocks never
+    // reach the global malloc. Requests over the hard limit fail; Lua 5.2+ then runs
+    // an emergency full collection and raises a memory error if that did not help.
+    class LuaAllocator
+    {
+    public:
+        LuaAllocator() = default;
+        ~LuaAllocator();
+        LuaAllocator(const LuaAllocator&) = delete;
+        LuaAllocator& operator=(const LuaAllocator&) = delete;
+
+        // lua_Alloc entry point, ud is the LuaAllocator instance
+        static void* Allocate(void* ud, void* ptr, size_t osize, size_t nsize);
+
+        void SetLimits(size_t softBytes, size_t hardBytes);
+        void SetOwner(int32 stateId) { ownerStateId = stateId; }
+
+        size_t GetLiveBytes() const { return liveBytes.load(std::memory_order_relaxed); }
+        size_t GetPeakBytes() const { return peakBytes.load(std::memory_order_relaxed); }
+
+        // True once each time the soft limit is crossed
+        bool ConsumeSoftLimitReached();
+
+    private:
+        static constexpr size_t SIZE_CLASS_GRANULARITY = 16;
+        static constexpr size_t MAX_SMALL_SIZE = 256;
+        static constexpr size_t SIZE_CLASS_COUNT = MAX_SMALL_SIZE / SIZE_CLASS_GRANULARITY;
+        static constexpr size_t PAGE_SIZE = 64 * 1024;
+
+        struct FreeBlock
+        {
+            FreeBlock* next;
+        };
+
+        std::array<FreeBlock*, SIZE_CLASS_COUNT> freeLists{};
+        std::vector<void*> pages;
+        char* pageCursor = nullptr;
+        size_t pageRemaining = 0;
+
+        // Single writer (the owning thread), relaxed loads from the world thread
+        std::atomic<size_t> liveBytes{ 0 };
+        std::atomic<size_t> peakBytes{ 0 };
+
+        size_t softLimit = 0;
+        size_t hardLimit = 0;
+        bool softLimitReached = false;
+        bool overSoftLimit = false;
+        bool hardLimitReported = false;
+        int32 ownerStateId = -1;
+
+        void* Reallocate(void* ptr, size_t osize, size_t nsize);
+
+        static bool IsSmall(size_t size) { return size <= MAX_SMALL_SIZE; }
+        static size_t GetSizeClass(size_t size) { return (size + SIZE_CLASS_GRANULARITY - 1) / SIZE_CLASS_GRANULARITY - 1; }
+
+        void* AcquireSmall(size_t size);
+        void ReleaseSmall(void* ptr, size_t size);
+
+        void UpdateLiveBytes(size_t oldSize, size_t newSize);
+    };
+}
+
+#endif // ECLIPSE_LUA_ALLOCATOR_HPP
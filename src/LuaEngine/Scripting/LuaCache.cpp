@@ -1,5 +1,4 @@
 #include "LuaCache.hpp"
-#include <boost/filesystem.hpp>
 
 namespace Eclipse
 {
@@ -9,98 +8,132 @@ namespace Eclipse
         return instance;
     }
 
-    std::chrono::system_clock::time_point LuaCache::GetFileWriteTime(const std::string& filePath) const
+    LuaCache::LuaCache() : current(std::make_shared<const CacheSnapshot>())
     {
-        boost::system::error_code ec;
-        auto writeTime = boost::filesystem::last_write_time(filePath, ec);
+    }
+
+    BytecodeRef LuaCache::GetBytecode(const std::string& filePath) const
+    {
+        CacheSnapshotRef snapshot = GetSnapshot();
 
-        if (ec)
+        auto it = snapshot->entries.find(filePath);
+        if (it == snapshot->entries.end() || !it->second.compilationSuccess)
         {
-            LOG_ERROR("server.eclipse", "[Eclipse]: Failed to get write time for file {}: {}", filePath, ec.message());
-            return std::chrono::system_clock::time_point{};
+            return nullptr;
         }
 
-        // Convert boost time to chrono time_point
-        return std::chrono::system_clock::from_time_t(writeTime);
+        return it->second.bytecode;
     }
 
-    std::optional<std::vector<char>> LuaCache::GetBytecode(const std::string& filePath)
+    void LuaCache::StoreBytecode(const std::string& filePath, std::vector<char>&& bytecode, bool success, const FileFingerprint& sourceFingerprint)
     {
-        auto it = cache_.find(filePath);
-        if (it == cache_.end())
-        {
-            return std::nullopt;
-        }
-
-        auto& entry = it->second;
+        StoreBytecode(filePath, MakeBytecode(std::move(bytecode)), success, sourceFingerprint);
+    }
 
-        if (IsScriptModified(filePath))
-        {
-            InvalidateScript(filePath);
-            return std::nullopt;
-        }
+    void LuaCache::StoreBytecode(const std::string& filePath, BytecodeRef bytecode, bool success, const FileFingerprint& sourceFingerprint)
+    {
+        CacheEntry entry(std::move(bytecode), sourceFingerprint);
+        entry.compilationSuccess = success;
 
-        if (!entry.compilationSuccess)
         {
-            return std::nullopt;
+            std::lock_guard<std::recursive_mutex> lock(writeMutex);
+            GetPendingSnapshot().entries.insert_or_assign(filePath, std::move(entry));
+            Publish();
         }
 
-        return entry.bytecode;
+        LOG_DEBUG("server.eclipse", "[Eclipse]: Cached script: {} (success: {})", filePath, success);
     }
 
-    void LuaCache::StoreBytecode(const std::string& filePath, std::vector<char>&& bytecode, bool success)
+    std::optional<uint64> LuaCache::GetContentHash(const std::string& filePath) const
     {
-        auto writeTime = GetFileWriteTime(filePath);
-
-        CacheEntry entry(std::move(bytecode), writeTime);
-        entry.compilationSuccess = success;
+        CacheSnapshotRef snapshot = GetSnapshot();
 
-        cache_.emplace(filePath, std::move(entry));
-        timestampCache_[filePath] = writeTime;
+        auto it = snapshot->entries.find(filePath);
+        if (it == snapshot->entries.end())
+        {
+            return std::nullopt;
+        }
 
-        LOG_DEBUG("server.eclipse", "[Eclipse]: Cached script: {} (success: {})", filePath, success);
+        return it->second.fingerprint.contentHash;
     }
 
     void LuaCache::InvalidateScript(const std::string& filePath)
     {
-        cache_.erase(filePath);
-        timestampCache_.erase(filePath);
+        {
+            std::lock_guard<std::recursive_mutex> lock(writeMutex);
+            GetPendingSnapshot().entries.erase(filePath);
+            Publish();
+        }
+
         LOG_TRACE("server.eclipse", "[Eclipse]: Invalidated cache for script: {}", filePath);
     }
 
     void LuaCache::InvalidateAllScripts()
     {
-        cache_.clear();
-        timestampCache_.clear();
+        std::lock_guard<std::recursive_mutex> lock(writeMutex);
+        pending = std::make_unique<CacheSnapshot>();
+        Publish();
     }
 
-    bool LuaCache::IsScriptModified(const std::string& filePath) const
+    bool LuaCache::IsScriptModified(const std::string& filePath)
     {
-        auto it = cache_.find(filePath);
-        if (it == cache_.end()) {
+        CacheSnapshotRef snapshot = GetSnapshot();
+
+        auto it = snapshot->entries.find(filePath);
+        if (it == snapshot->entries.end())
+        {
             return true;
         }
 
-        auto timestampIt = timestampCache_.find(filePath);
-        std::chrono::system_clock::time_point currentWriteTime;
+        auto onDisk = FileFingerprint::Stat(filePath);
+        if (!onDisk)
+        {
+            return true;
+        }
 
-        if (timestampIt != timestampCache_.end()) {
-            currentWriteTime = timestampIt->second;
-        } else {
-            currentWriteTime = GetFileWriteTime(filePath);
-            timestampCache_[filePath] = currentWriteTime;
+        const auto& stored = it->second.fingerprint;
+        if (onDisk->SameMetadata(stored))
+        {
+            return false;
         }
 
-        return (currentWriteTime == std::chrono::system_clock::time_point{} || 
-                currentWriteTime != it->second.lastWriteTime);
+        // Metadata changed (touch, copy, checkout): only a different content counts
+        auto contentHash = FileFingerprint::HashFile(filePath);
+        if (!contentHash || *contentHash != stored.contentHash)
+        {
+            return true;
+        }
+
+        onDisk->contentHash = *contentHash;
+        RefreshFingerprint(filePath, *onDisk);
+        return false;
+    }
+
+    void LuaCache::RefreshFingerprint(const std::string& filePath, const FileFingerprint& fingerprint)
+    {
+        std::lock_guard<std::recursive_mutex> lock(writeMutex);
+
+        auto& entries = GetPendingSnapshot().entries;
+        auto it = entries.find(filePath);
+        if (it != entries.end())
+        {
+            it->second.fingerprint = fingerprint;
+        }
+
+        Publish();
     }
 
-    std::vector<std::string> LuaCache::GetModifiedScripts() const
+    std::vector<std::string> LuaCache::GetModifiedScripts()
     {
+        // Fingerprint refreshes below are published once
+        UpdateScope scope;
+
+        CacheSnapshotRef snapshot = GetSnapshot();
+
         std::vector<std::string> modifiedScripts;
-        modifiedScripts.reserve(cache_.size());
+        modifiedScripts.reserve(snapshot->entries.size());
 
-        for (const auto& [filePath, entry] : cache_) {
+        for (const auto& [filePath, entry] : snapshot->entries) {
             if (IsScriptModified(filePath)) {
                 modifiedScripts.emplace_back(filePath);
             }
@@ -111,10 +144,12 @@ namespace Eclipse
 
     std::vector<std::string> LuaCache::GetAllCachedScripts() const
     {
+        CacheSnapshotRef snapshot = GetSnapshot();
+
         std::vector<std::string> scripts;
-        scripts.reserve(cache_.size());
+        scripts.reserve(snapshot->entries.size());
 
-        for (const auto& [filePath, entry] : cache_) {
+        for (const auto& [filePath, entry] : snapshot->entries) {
             if (entry.compilationSuccess) {
                 scripts.emplace_back(filePath);
             }
@@ -127,4 +162,40 @@ namespace Eclipse
     {
         InvalidateAllScripts();
     }
-}
\ No newline at end of file
+
+    void LuaCache::BeginUpdate()
+    {
+        writeMutex.lock();
+        ++updateDepth;
+    }
+
+    void LuaCache::EndUpdate()
+    {
+        if (--updateDepth == 0)
+        {
+            Publish();
+        }
+
+        writeMutex.unlock();
+    }
+
+    CacheSnapshot& LuaCache::GetPendingSnapshot()
+    {
+        if (!pending)
+        {
+            pending = std::make_unique<CacheSnapshot>(*GetSnapshot());
+        }
+
+        return *pending;
+    }
+
+    void LuaCache::Publish()
+    {
+        if (updateDepth || !pending)
+        {
+            return;
+        }
+
+        std::atomic_store_explicit(&current, CacheSnapshotRef(std::move(pending)), std::memory_order_release);
+    }
+}
@@ -2,57 +2,94 @@
 #define ECLIPSE_LUA_CACHE_HPP
 
 #include "EclipseIncludes.hpp"
+#include "BytecodeBuffer.hpp"
+#include "FileFingerprint.hpp"
 
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <string>
 #include <vector>
 #include <optional>
-#include <boost/filesystem.hpp>
-#include <chrono>
 
 namespace Eclipse
 {
     struct CacheEntry
     {
-        std::vector<char> bytecode;
-        std::chrono::system_clock::time_point lastWriteTime;
+        BytecodeRef bytecode;
+        FileFingerprint fingerprint;
         bool compilationSuccess = true;
 
         CacheEntry() = default;
-        CacheEntry(std::vector<char>&& data, std::chrono::system_clock::time_point writeTime)
-            : bytecode(std::move(data)), lastWriteTime(writeTime) {}
+        CacheEntry(BytecodeRef data, const FileFingerprint& sourceFingerprint)
+            : bytecode(std::move(data)), fingerprint(sourceFingerprint) {}
     };
 
+    // Immutable view of the cache, replaced as a whole on every write
+    struct CacheSnapshot
+    {
+        std::unordered_map<std::string, CacheEntry> entries;
+    };
+
+    using CacheSnapshotRef = std::shared_ptr<const CacheSnapshot>;
+
+    // Readers take the current snapshot with a single atomic load and never lock, the
+    // reference keeps it alive on any thread (map updates, compiler and reload workers).
+    // Writers copy it and publish the copy; the old one goes away with its last reader.
     class LuaCache
     {
     public:
         static LuaCache& GetInstance();
 
         // Core cache operations
-        std::optional<std::vector<char>> GetBytecode(const std::string& filePath);
-        void StoreBytecode(const std::string& filePath, std::vector<char>&& bytecode, bool success = true);
+        BytecodeRef GetBytecode(const std::string& filePath) const;
+        // Fingerprint taken when the source was read, so later edits are still detected
+        void StoreBytecode(const std::string& filePath, std::vector<char>&& bytecode, bool success, const FileFingerprint& sourceFingerprint);
+        void StoreBytecode(const std::string& filePath, BytecodeRef bytecode, bool success, const FileFingerprint& sourceFingerprint);
+        // Keeps the cached bytecode, the file is no longer reported as modified
+        void RefreshFingerprint(const std::string& filePath, const FileFingerprint& fingerprint);
+        std::optional<uint64> GetContentHash(const std::string& filePath) const;
         void InvalidateScript(const std::string& filePath);
         void InvalidateAllScripts();
-        bool IsScriptModified(const std::string& filePath) const;
-        std::vector<std::string> GetModifiedScripts() const;
+        bool IsScriptModified(const std::string& filePath);
+        bool Contains(const std::string& filePath) const { return GetSnapshot()->entries.count(filePath) != 0; }
+        std::vector<std::string> GetModifiedScripts();
 
         std::vector<std::string> GetAllCachedScripts() const;
 
+        CacheSnapshotRef GetSnapshot() const { return std::atomic_load_explicit(&current, std::memory_order_acquire); }
+
         void Clear();
-        void ClearTimestampCache() const { timestampCache_.clear(); }
+
+        // Groups writes into a single published snapshot
+        class UpdateScope
+        {
+        public:
+            UpdateScope() { LuaCache::GetInstance().BeginUpdate(); }
+            ~UpdateScope() { LuaCache::GetInstance().EndUpdate(); }
+            UpdateScope(const UpdateScope&) = delete;
+            UpdateScope& operator=(const UpdateScope&) = delete;
+        };
 
     private:
-        LuaCache() = default;
+        LuaCache();
         ~LuaCache() = default;
         LuaCache(const LuaCache&) = delete;
         LuaCache& operator=(const LuaCache&) = delete;
 
-        std::unordered_map<std::string, CacheEntry> cache_;
-        mutable std::unordered_map<std::string, std::chrono::system_clock::time_point> timestampCache_;
+        // Only accessed through the std::atomic_* shared_ptr functions
+        CacheSnapshotRef current;
+
+        // Writer side
+        std::recursive_mutex writeMutex;
+        std::unique_ptr<CacheSnapshot> pending;
+        uint32 updateDepth = 0;
 
-        // Helper methods
-        std::chrono::system_clock::time_point GetFileWriteTime(const std::string& filePath) const;
+        void BeginUpdate();
+        void EndUpdate();
+        CacheSnapshot& GetPendingSnapshot();
+        void Publish();
     };
 }
 
-#endif // ECLIPSE_LUA_CACHE_HPP
\ No newline at end of file
+#endif // ECLIPSE_LUA_CACHE_HPP
@@ -1,5 +1,9 @@
 #include "LuaCompiler.hpp"
 #include "EclipseLogger.hpp"
+#include "BytecodeDiskCache.hpp"
+#include "EclipseConfig.hpp"
+#include "LineMap.hpp"
+#include "ContentHash.hpp"
 #include <filesystem>
 #include <fstream>
 #include <sstream>
@@ -23,33 +27,65 @@ namespace Eclipse
         return content;
     }
 
-    std::string LuaCompiler::CompileMoonScriptToLua(sol::state& compilerState, const std::string& moonFilePath)
+    sol::table LuaCompiler::GetMoonScript(sol::state& compilerState)
+    {
+        sol::object loaded = compilerState.registry()[MOONSCRIPT_KEY];
+        if (loaded.is<sol::table>())
+        {
+            return loaded.as<sol::table>();
+        }
+
+        // moonscript.base does not install the .moon package loader, scripts are compiled here
+        sol::table moonscript = compilerState["require"]("moonscript.base");
+        sol::table version = compilerState["require"]("moonscript.version");
+
+        compilerState.registry()[MOONSCRIPT_KEY] = moonscript;
+        compilerState.registry()[MOONSCRIPT_VERSION_KEY] = version.get_or<std::string>("version", "unknown");
+        return moonscript;
+    }
+
+    std::string LuaCompiler::CompileMoonScriptToLua(sol::state& compilerState, const std::string& moonSource, const std::string& chunkName)
     {
         try
         {
-            sol::table moonscript = compilerState["require"]("moonscript");
-            sol::function loadfile = moonscript["loadfile"];
-            sol::object result = loadfile(moonFilePath);
+            sol::table moonscript = GetMoonScript(compilerState);
+            std::string version = compilerState.registry()[MOONSCRIPT_VERSION_KEY];
 
-            if (result.valid())
+            auto& diskCache = BytecodeDiskCache::GetInstance();
+            if (auto cached = diskCache.LoadTranslation(chunkName, moonSource, version))
             {
-                sol::function tostring = compilerState["tostring"];
-                return tostring(result).get<std::string>();
+                return std::move(*cached);
             }
-            else
+
+            sol::protected_function toLua = moonscript["to_lua"];
+            sol::protected_function_result result = toLua(moonSource);
+            if (!result.valid())
             {
-                EclipseLogger::GetInstance().LogLuaCompilationError(moonFilePath, "Failed to compile MoonScript file");
+                sol::error error = result;
+                HandleCompilationError(chunkName, error.what());
                 return "";
             }
+
+            // to_lua returns the Lua code, or nil and the error
+            auto luaSource = result.get<sol::optional<std::string>>(0);
+            if (!luaSource)
+            {
+                auto error = result.get<sol::optional<std::string>>(1);
+                EclipseLogger::GetInstance().LogLuaCompilationError(chunkName, error.value_or("Failed to compile MoonScript file"));
+                return "";
+            }
+
+            diskCache.StoreTranslation(chunkName, moonSource, version, *luaSource);
+            return std::move(*luaSource);
         }
         catch (const std::exception& e)
         {
-            HandleCompilationError(moonFilePath, e.what());
+            HandleCompilationError(chunkName, e.what());
             return "";
         }
     }
 
-    std::vector<char> LuaCompiler::CompileTobytecode(sol::state& compilerState, const std::string& luaSource, const std::string& chunkName)
+    std::vector<char> LuaCompiler::CompileTobytecode(sol::state& compilerState, const std::string& luaSource, const std::string& chunkName, bool strip)
     {
         try
         {
@@ -79,7 +115,34 @@ namespace Eclipse
                 return 0;
             };
 
-            if (lua_dump(L, dumpWriter, &writer, 0) != 0)
+#if SOL_LUAJIT
+            // LuaJIT's lua_dump cannot strip, string.dump can
+            if (strip)
+            {
+                lua_getglobal(L, "string");
+                lua_getfield(L, -1, "dump");
+                lua_remove(L, -2);
+                lua_insert(L, -2);
+                lua_pushboolean(L, 1);
+
+                if (lua_pcall(L, 2, 1, 0) != LUA_OK)
+                {
+                    std::string error = lua_tostring(L, -1);
+                    lua_pop(L, 1);
+                    HandleCompilationError(chunkName, "Failed to dump bytecode: " + error);
+                    return {};
+                }
+
+                size_t size = 0;
+                const char* data = lua_tolstring(L, -1, &size);
+                std::vector<char> bytecode(data, data + size);
+                lua_pop(L, 1);
+                return bytecode;
+            }
+#endif
+
+            // The strip argument is dropped before 5.3, EclipseConfig turns StripBytecode off there
+            if (lua_dump(L, dumpWriter, &writer, strip ? 1 : 0) != 0)
             {
                 lua_pop(L, 1);
                 HandleCompilationError(chunkName, "Failed to dump bytecode");
@@ -96,57 +159,69 @@ namespace Eclipse
         }
     }
 
-    std::vector<char> LuaCompiler::CompileFileTobytecode(sol::state& compilerState, const std::string& filePath)
+    std::vector<char> LuaCompiler::CompileFileTobytecode(sol::state& compilerState, const std::string& filePath, FileFingerprint& sourceFingerprint)
     {
-        if (!std::filesystem::exists(filePath))
+        // An edit saved after the stat changes the metadata, it is seen as a change later
+        auto fingerprint = FileFingerprint::Stat(filePath);
+        if (!fingerprint)
         {
             EclipseLogger::GetInstance().LogScriptNotFound(filePath, false);
             return {};
         }
 
+        std::string content = ReadFileContent(filePath);
+        fingerprint->contentHash = ContentHash::Compute(content.data(), content.size());
+        sourceFingerprint = *fingerprint;
+
+        return CompileSourceTobytecode(compilerState, filePath, std::move(content));
+    }
+
+    std::vector<char> LuaCompiler::CompileSourceTobytecode(sol::state& compilerState, const std::string& filePath, std::string&& fileContent)
+    {
         std::filesystem::path path(filePath);
         std::string extension = path.extension().string();
-        std::string luaSource;
 
-        if (extension == ".moon")
+        if (extension == ".out")
         {
-            luaSource = CompileMoonScriptToLua(compilerState, filePath);
-            if (luaSource.empty())
-            {
-                return {};
-            }
+            return std::vector<char>(fileContent.begin(), fileContent.end());
         }
-        else if (extension == ".lua" || extension == ".ext")
+
+        if (extension != ".moon" && extension != ".lua" && extension != ".ext")
         {
-            luaSource = ReadFileContent(filePath);
-            if (luaSource.empty())
-            {
-                return {};
-            }
+            EclipseLogger::GetInstance().LogError("Unsupported script file extension: " + extension);
+            return {};
         }
-        else if (extension == ".out")
+
+        // The cache is keyed by the file as written, so MoonScript is skipped too on a hit
+        if (fileContent.empty())
         {
-            std::ifstream file(filePath, std::ios::binary);
-            if (!file.is_open())
-            {
-                EclipseLogger::GetInstance().LogError("Failed to open precompiled file: " + filePath);
-                return {};
-            }
+            return {};
+        }
 
-            file.seekg(0, std::ios::end);
-            std::vector<char> bytecode;
-            bytecode.reserve(file.tellg());
-            file.seekg(0, std::ios::beg);
-            bytecode.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
-            return bytecode;
+        bool strip = EclipseConfig::GetInstance().IsStripBytecodeEnabled();
+        auto& diskCache = BytecodeDiskCache::GetInstance();
+        if (auto cached = diskCache.Load(filePath, fileContent, strip))
+        {
+            // MoonScript line ranges come from the translation, which a cache hit skips
+            if (strip && extension != ".moon")
+                LineMap::GetInstance().Store(filePath, LineMap::Scan(fileContent));
+
+            EclipseLogger::GetInstance().LogTrace("Loaded bytecode from disk cache: " + filePath);
+            return std::move(*cached);
         }
-        else
+
+        std::string luaSource = extension == ".moon" ? CompileMoonScriptToLua(compilerState, fileContent, filePath) : std::move(fileContent);
+        if (luaSource.empty())
         {
-            EclipseLogger::GetInstance().LogError("Unsupported script file extension: " + extension);
             return {};
         }
 
-        return CompileTobytecode(compilerState, luaSource, filePath);
+        std::vector<char> bytecode = CompileTobytecode(compilerState, luaSource, filePath, strip);
+        if (strip && !bytecode.empty())
+            LineMap::GetInstance().Store(filePath, LineMap::Scan(luaSource));
+
+        diskCache.Store(filePath, extension == ".moon" ? fileContent : luaSource, bytecode, strip);
+        return bytecode;
     }
 
     void LuaCompiler::HandleCompilationError(const std::string& source, const std::string& error)
@@ -2,6 +2,7 @@
 #define ECLIPSE_LUA_COMPILER_HPP
 
 #include "EclipseIncludes.hpp"
+#include "FileFingerprint.hpp"
 #include <string>
 #include <vector>
 
@@ -14,14 +15,22 @@ namespace Eclipse
         ~LuaCompiler() = default;
 
         // Pure compilation interface - no state management
-        static std::vector<char> CompileTobytecode(sol::state& compilerState, const std::string& luaSource, const std::string& chunkName = "chunk");
-        static std::string CompileMoonScriptToLua(sol::state& compilerState, const std::string& moonFilePath);
+        static std::vector<char> CompileTobytecode(sol::state& compilerState, const std::string& luaSource, const std::string& chunkName = "chunk", bool strip = false);
+        static std::string CompileMoonScriptToLua(sol::state& compilerState, const std::string& moonSource, const std::string& chunkName);
         static std::string ReadFileContent(const std::string& filePath);
 
-        // Full compilation chain for different file types
-        static std::vector<char> CompileFileTobytecode(sol::state& compilerState, const std::string& filePath);
+        // Full compilation chain for different file types. sourceFingerprint describes the
+        // content that was compiled, its metadata is taken before the file is read.
+        static std::vector<char> CompileFileTobytecode(sol::state& compilerState, const std::string& filePath, FileFingerprint& sourceFingerprint);
+        // Same chain for content already read from filePath, .out content is bytecode as is
+        static std::vector<char> CompileSourceTobytecode(sol::state& compilerState, const std::string& filePath, std::string&& fileContent);
 
     private:
+        static constexpr const char* MOONSCRIPT_KEY = "eclipse.moonscript";
+        static constexpr const char* MOONSCRIPT_VERSION_KEY = "eclipse.moonscript_version";
+
+        // Required once per compiler state, then kept in its registry
+        static sol::table GetMoonScript(sol::state& compilerState);
         static void HandleCompilationError(const std::string& source, const std::string& error);
     };
 }
@@ -1,5 +1,6 @@
 #include "LuaPathManager.hpp"
-#include "ScriptLoader.hpp"
+#include "ScriptIndex.hpp"
+#include "LuaCache.hpp"
 #include "../Core/EclipseConfig.hpp"
 #include "EclipseIncludes.hpp"
 #include <filesystem>
@@ -10,6 +11,7 @@ namespace Eclipse
 {
     void LuaPathManager::InitializeDefaultPaths()
     {
+        std::lock_guard<std::mutex> lock(mutex);
         if (initialized) return;
 
         LOG_DEBUG("server.eclipse", "[Eclipse]: Initializing LuaPathManager with default paths");
@@ -28,23 +30,23 @@ namespace Eclipse
 
     void LuaPathManager::DiscoverLuaScriptDirectories()
     {
+        // Same root as the script loader, so the tree is indexed once
         std::string currentPath = boost::filesystem::current_path().string();
-        std::string luaScriptsPath = currentPath + "/lua_scripts";
+        auto& index = ScriptIndex::GetInstance();
+        index.Refresh("lua_scripts");
 
-        auto scripts = ScriptLoader::DiscoverScripts(luaScriptsPath);
-        auto directories = ScriptLoader::ExtractDirectoriesFromScripts(scripts);
-
-        directories.insert(luaScriptsPath);
-
-        for (const auto& dir : directories)
+        for (const auto& dir : index.GetDirectories("lua_scripts"))
         {
-            processedPaths.insert(dir);
-            LOG_DEBUG("server.eclipse", "[Eclipse]: Added lua_scripts directory to paths: {}", dir);
+            std::string path = currentPath + "/" + dir;
+            processedPaths.insert(path);
+            LOG_DEBUG("server.eclipse", "[Eclipse]: Added lua_scripts directory to paths: {}", path);
         }
     }
 
     void LuaPathManager::AddSearchPath(const std::string& path)
     {
+        std::lock_guard<std::mutex> lock(mutex);
+
         try
         {
             if (processedPaths.insert(path).second)
@@ -64,13 +66,24 @@ namespace Eclipse
     {
         try
         {
-            // lazy rebuild
-            if (pathsDirty) {
-                BuildPaths();
+            std::string path;
+            std::string cpath;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+
+                // lazy rebuild
+                if (pathsDirty) {
+                    BuildPaths();
+                }
+
+                path = luaRequirePath;
+                cpath = luaRequireCPath;
             }
 
-            lua["package"]["path"] = luaRequirePath;
-            lua["package"]["cpath"] = luaRequireCPath;
+            lua["package"]["path"] = path;
+            lua["package"]["cpath"] = cpath;
+
+            InstallSearcher(lua);
         }
         catch (const std::exception& e)
         {
@@ -81,6 +94,7 @@ namespace Eclipse
 
     void LuaPathManager::Reset()
     {
+        std::lock_guard<std::mutex> lock(mutex);
         processedPaths.clear();
         luaRequirePath.clear();
         luaRequireCPath.clear();
@@ -92,6 +106,7 @@ namespace Eclipse
 
     bool LuaPathManager::HasPath(const std::string& path) const
     {
+        std::lock_guard<std::mutex> lock(mutex);
         return processedPaths.find(path) != processedPaths.end();
     }
 
@@ -141,4 +156,68 @@ namespace Eclipse
         customRequireCPath = std::string(config.GetRequireCPathExtra());
         pathsDirty = true;
     }
-}
\ No newline at end of file
+
+    void LuaPathManager::InstallSearcher(sol::state& lua)
+    {
+        lua_State* L = lua.lua_state();
+
+        lua_getglobal(L, "package");
+        lua_getfield(L, -1, "searchers");
+        if (!lua_istable(L, -1))
+        {
+            // Lua 5.1 and LuaJIT
+            lua_pop(L, 1);
+            lua_getfield(L, -1, "loaders");
+        }
+
+        if (!lua_istable(L, -1))
+        {
+            lua_pop(L, 2);
+            return;
+        }
+
+        // Right after the preload searcher, package.preload keeps precedence
+#if LUA_VERSION_NUM >= 502
+        int count = static_cast<int>(lua_rawlen(L, -1));
+#else
+        int count = static_cast<int>(lua_objlen(L, -1));
+#endif
+        for (int i = count; i >= 2; --i)
+        {
+            lua_rawgeti(L, -1, i);
+            lua_rawseti(L, -2, i + 1);
+        }
+
+        lua_pushcfunction(L, &LuaPathManager::CachedModuleSearcher);
+        lua_rawseti(L, -2, 2);
+        lua_pop(L, 2);
+    }
+
+    int LuaPathManager::CachedModuleSearcher(lua_State* L)
+    {
+        const char* moduleName = luaL_checkstring(L, 1);
+
+        // Misses fall through to the package.path searcher
+        auto scriptPath = ScriptIndex::GetInstance().ResolveModule(moduleName);
+        if (!scriptPath)
+        {
+            lua_pushfstring(L, "\n\tno indexed script '%s'", moduleName);
+            return 1;
+        }
+
+        BytecodeRef bytecode = LuaCache::GetInstance().GetBytecode(*scriptPath);
+        if (!bytecode)
+        {
+            lua_pushfstring(L, "\n\tno cached bytecode for '%s'", scriptPath->c_str());
+            return 1;
+        }
+
+        if (luaL_loadbuffer(L, bytecode->Data(), bytecode->Size(), scriptPath->c_str()) != LUA_OK)
+        {
+            return luaL_error(L, "error loading module '%s' from cache:\n\t%s", moduleName, lua_tostring(L, -1));
+        }
+
+        lua_pushstring(L, scriptPath->c_str());
+        return 2;
+    }
+}
@@ -2,12 +2,15 @@
 #define ECLIPSE_LUA_PATH_MANAGER_HPP
 
 #include "EclipseIncludes.hpp"
+#include <mutex>
 #include <string>
 #include <set>
 #include <vector>
 
 namespace Eclipse
 {
+    // Shared by every thread creating states: the world thread, the startup precompile
+    // and the background reload, so all access goes through the mutex
     class LuaPathManager
     {
     public:
@@ -23,8 +26,8 @@ namespace Eclipse
         void Reset();
         bool HasPath(const std::string& path) const;
 
-        const std::string& GetLuaPath() const { return luaRequirePath; }
-        const std::string& GetLuaCPath() const { return luaRequireCPath; }
+        std::string GetLuaPath() const { std::lock_guard<std::mutex> lock(mutex); return luaRequirePath; }
+        std::string GetLuaCPath() const { std::lock_guard<std::mutex> lock(mutex); return luaRequireCPath; }
 
     private:
         LuaPathManager() = default;
@@ -32,6 +35,7 @@ namespace Eclipse
         LuaPathManager(const LuaPathManager&) = delete;
         LuaPathManager& operator=(const LuaPathManager&) = delete;
 
+        mutable std::mutex mutex;
         std::set<std::string> processedPaths;
         std::string luaRequirePath;
         std::string luaRequireCPath;
@@ -43,6 +47,10 @@ namespace Eclipse
         void BuildPaths();
         void DiscoverLuaScriptDirectories();
         void AddConfigPaths();
+
+        // package.searchers entry resolving indexed scripts to their cached bytecode
+        static int CachedModuleSearcher(lua_State* L);
+        static void InstallSearcher(sol::state& lua);
     };
 }
 
@@ -1,19 +1,42 @@
 #include "LuaState.hpp"
+#include "EclipseConfig.hpp"
+#include "ScriptLoader.hpp"
+
+#include <algorithm>
+#include <chrono>
 
 namespace Eclipse
 {
-    LuaState::LuaState() : isInitialized(false)
+    LuaState::LuaState() : allocator(std::make_unique<LuaAllocator>()), luaState(CreateState()), isInitialized(false)
+    {
+    }
+
+    sol::state LuaState::CreateState()
     {
+#if SOL_LUAJIT
+        // LuaJIT manages its own arena and rejects custom allocators on most builds
+        return sol::state();
+#else
+        return sol::state(sol::default_at_panic, &LuaAllocator::Allocate, allocator.get());
+#endif
     }
 
-    bool LuaState::Initialize()
+    bool LuaState::Initialize(int32 stateId)
     {
         if (isInitialized)
             return true;
 
         try
         {
-            luaState = sol::state();
+            auto& config = EclipseConfig::GetInstance();
+            allocator->SetOwner(stateId);
+            allocator->SetLimits(static_cast<size_t>(config.GetMemorySoftLimit()) * 1024 * 1024,
+                static_cast<size_t>(config.GetMemoryHardLimit()) * 1024 * 1024);
+
+            luaState = CreateState();
+            stepCycleRunning = false;
+            heapAfterStepCycleKB = 0;
+            ConfigureGarbageCollector();
             OpenStandardLibraries();
 
             isInitialized = true;
@@ -33,22 +56,115 @@ namespace Eclipse
         if (isInitialized)
         {
             try {
-                luaState.collect_garbage();
-
-                luaState = sol::state();
+                // Closing the old state frees everything, a collection beforehand is wasted work
+                luaState = CreateState();
+                ConfigureGarbageCollector();
                 OpenStandardLibraries();
 
                 isInitialized = false;
-                LOG_TRACE("server.eclipse", "[Eclipse]: LuaState reset (optimized with GC)");
+                LOG_TRACE("server.eclipse", "[Eclipse]: LuaState reset");
             }
             catch (const std::exception& e) {
-                luaState = sol::state();
+                luaState = CreateState();
                 isInitialized = false;
                 LOG_TRACE("server.eclipse", "[Eclipse]: LuaState reset (fallback)");
             }
         }
     }
 
+    size_t LuaState::GetMemoryUsage() const
+    {
+        if (!isInitialized)
+            return 0;
+
+#if SOL_LUAJIT
+        lua_State* L = luaState.lua_state();
+        return static_cast<size_t>(lua_gc(L, LUA_GCCOUNT, 0)) * 1024 + static_cast<size_t>(lua_gc(L, LUA_GCCOUNTB, 0));
+#else
+        return allocator->GetLiveBytes();
+#endif
+    }
+
+    size_t LuaState::GetPeakMemoryUsage() const
+    {
+#if SOL_LUAJIT
+        return GetMemoryUsage();
+#else
+        return allocator->GetPeakBytes();
+#endif
+    }
+
+    void LuaState::CheckMemoryLimits()
+    {
+        if (!isInitialized || !allocator->ConsumeSoftLimitReached())
+            return;
+
+        size_t before = allocator->GetLiveBytes();
+        luaState.collect_garbage();
+        LOG_WARN("server.eclipse", "[Eclipse]: Lua state crossed its soft memory limit, full collection freed {} KB ({} KB live)",
+            (before - std::min(before, allocator->GetLiveBytes())) / 1024, allocator->GetLiveBytes() / 1024);
+    }
+
+    void LuaState::ConfigureGarbageCollector()
+    {
+        auto& config = EclipseConfig::GetInstance();
+        lua_State* L = luaState.lua_state();
+        int pause = static_cast<int>(config.GetGCPause());
+        int stepMul = static_cast<int>(config.GetGCStepMultiplier());
+
+        generationalGC = config.GetGCMode() == "generational";
+
+#if LUA_VERSION_NUM >= 504
+        if (generationalGC)
+            lua_gc(L, LUA_GCGEN, 0, 0);
+        else
+            lua_gc(L, LUA_GCINC, pause, stepMul, 0);
+#else
+        if (generationalGC)
+        {
+            LOG_WARN("server.eclipse", "[Eclipse]: Generational GC requires Lua 5.4, using incremental mode");
+            generationalGC = false;
+        }
+
+        if (pause)
+            lua_gc(L, LUA_GCSETPAUSE, pause);
+        if (stepMul)
+            lua_gc(L, LUA_GCSETSTEPMUL, stepMul);
+#endif
+    }
+
+    void LuaState::StepGarbageCollector()
+    {
+        // Minor collections are already cheap, forcing them would only add work
+        uint32 budget = EclipseConfig::GetInstance().GetGCStepBudget();
+        if (!isInitialized || generationalGC || !budget)
+            return;
+
+        lua_State* L = luaState.lua_state();
+
+        // Right after a cycle there is little to collect, stepping would only start the next
+        // one early and spend the whole budget on every update
+        if (!stepCycleRunning)
+        {
+            int heapKB = lua_gc(L, LUA_GCCOUNT, 0);
+            if (heapKB < heapAfterStepCycleKB + std::max(GC_STEP_MIN_GROWTH_KB, heapAfterStepCycleKB / 4))
+                return;
+
+            stepCycleRunning = true;
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(budget);
+        do
+        {
+            if (lua_gc(L, LUA_GCSTEP, 0))
+            {
+                stepCycleRunning = false;
+                heapAfterStepCycleKB = lua_gc(L, LUA_GCCOUNT, 0);
+                break;
+            }
+        } while (std::chrono::steady_clock::now() < deadline);
+    }
+
     void LuaState::ConfigureLibraries()
     {
         if (isInitialized)
@@ -75,5 +191,8 @@ namespace Eclipse
             , sol::lib::jit
 #endif
         );
+
+        // Protected functions created from here on report errors with a traceback
+        sol::protected_function::set_default_handler(sol::make_object(luaState, &ScriptLoader::TracebackHandler));
     }
 }
\ No newline at end of file
@@ -2,6 +2,9 @@
 #define ECLIPSE_LUA_STATE_HPP
 
 #include "EclipseIncludes.hpp"
+#include "LuaAllocator.hpp"
+
+#include <memory>
 
 namespace Eclipse
 {
@@ -11,7 +14,7 @@ namespace Eclipse
         LuaState();
         ~LuaState() = default;
 
-        bool Initialize();
+        bool Initialize(int32 stateId = -1);
         void Reset();
 
         sol::state& GetState() { return luaState; }
@@ -21,11 +24,34 @@ namespace Eclipse
 
         bool IsValid() const { return isInitialized; }
 
+        // Bytes currently allocated by this state
+        size_t GetMemoryUsage() const;
+        size_t GetPeakMemoryUsage() const;
+
+        // Runs a full collection if the soft limit was crossed since the last check
+        void CheckMemoryLimits();
+
+        // Incremental collection work bounded by Eclipse.GC.StepBudget, skipped while the
+        // heap barely grew since the last cycle it finished
+        void StepGarbageCollector();
+
     private:
+        // Declared before the state so it outlives it
+        std::unique_ptr<LuaAllocator> allocator;
         sol::state luaState;
         bool isInitialized;
 
+        bool generationalGC = false;
+
+        // Budgeted steps run from the first update where the heap grew enough after the
+        // last cycle they completed, until they complete the next one
+        static constexpr int GC_STEP_MIN_GROWTH_KB = 64;
+        bool stepCycleRunning = false;
+        int heapAfterStepCycleKB = 0;
+
         void OpenStandardLibraries();
+        void ConfigureGarbageCollector();
+        sol::state CreateState();
     };
 }
 
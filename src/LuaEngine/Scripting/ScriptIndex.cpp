@@ -0,0 +1,307 @@
+#include "ScriptIndex.hpp"
+#include "ScriptLoader.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <string_view>
+
+namespace Eclipse
+{
+    ScriptIndex& ScriptIndex::GetInstance()
+    {
+        static ScriptIndex instance;
+        return instance;
+    }
+
+    std::optional<int64> ScriptIndex::GetDirectoryTime(const std::string& directory)
+    {
+        std::error_code ec;
+        if (!std::filesystem::is_directory(directory, ec))
+            return std::nullopt;
+
+        auto writeTime = std::filesystem::last_write_time(directory, ec);
+        if (ec)
+            return std::nullopt;
+
+        return static_cast<int64>(writeTime.time_since_epoch().count());
+    }
+
+    bool ScriptIndex::Refresh(const std::string& rootPath)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (!GetDirectoryTime(rootPath))
+        {
+            trees.erase(rootPath);
+            return false;
+        }
+
+        RefreshDirectory(trees[rootPath], rootPath);
+        return true;
+    }
+
+    void ScriptIndex::RefreshDirectory(IndexedTree& tree, const std::string& directory)
+    {
+        auto mtime = GetDirectoryTime(directory);
+        if (!mtime)
+        {
+            RemoveDirectory(tree, directory);
+            return;
+        }
+
+        // Adding, removing or renaming an entry updates the directory mtime, editing a file does not
+        auto& indexed = tree.directories[directory];
+        if (indexed.mtime != *mtime)
+        {
+            ListDirectory(tree, directory, indexed);
+            indexed.mtime = *mtime;
+        }
+
+        for (const auto& subdirectory : std::vector<std::string>(indexed.subdirectories))
+        {
+            RefreshDirectory(tree, subdirectory);
+        }
+    }
+
+    void ScriptIndex::ListDirectory(IndexedTree& tree, const std::string& directory, IndexedDirectory& indexed)
+    {
+        std::vector<std::string> scripts;
+        std::vector<std::string> subdirectories;
+
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(directory, ec))
+        {
+            // Symlinked directories are not followed, as with recursive_directory_iterator, a link
+            // to a parent would otherwise be indexed forever
+            if (entry.is_symlink(ec) && entry.is_directory(ec))
+                continue;
+
+            if (entry.is_directory(ec))
+                subdirectories.emplace_back(entry.path().string());
+            else if (entry.is_regular_file(ec) && ScriptLoader::IsValidScriptExtension(entry.path().extension().string()))
+                scripts.emplace_back(entry.path().string());
+        }
+
+        std::sort(scripts.begin(), scripts.end());
+        std::sort(subdirectories.begin(), subdirectories.end());
+
+        for (const auto& script : indexed.scripts)
+        {
+            if (!std::binary_search(scripts.begin(), scripts.end(), script))
+                tree.scripts.erase(script);
+        }
+
+        for (const auto& script : scripts)
+        {
+            if (!tree.scripts.count(script))
+                tree.scripts.emplace(script, FileFingerprint::Stat(script).value_or(FileFingerprint{}));
+        }
+
+        for (const auto& subdirectory : indexed.subdirectories)
+        {
+            if (!std::binary_search(subdirectories.begin(), subdirectories.end(), subdirectory))
+                RemoveDirectory(tree, subdirectory);
+        }
+
+        indexed.scripts = std::move(scripts);
+        indexed.subdirectories = std::move(subdirectories);
+        moduleNamesDirty = true;
+    }
+
+    void ScriptIndex::RemoveDirectory(IndexedTree& tree, const std::string& directory)
+    {
+        auto it = tree.directories.find(directory);
+        if (it == tree.directories.end())
+            return;
+
+        IndexedDirectory removed = std::move(it->second);
+        tree.directories.erase(it);
+        moduleNamesDirty = true;
+
+        for (const auto& script : removed.scripts)
+            tree.scripts.erase(script);
+
+        for (const auto& subdirectory : removed.subdirectories)
+            RemoveDirectory(tree, subdirectory);
+    }
+
+    std::vector<std::string> ScriptIndex::GetScripts(const std::string& rootPath) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto it = trees.find(rootPath);
+        if (it == trees.end())
+            return {};
+
+        std::vector<std::string> scripts;
+        scripts.reserve(it->second.scripts.size());
+        for (const auto& [scriptPath, fingerprint] : it->second.scripts)
+            scripts.emplace_back(scriptPath);
+
+        return scripts;
+    }
+
+    std::vector<std::string> ScriptIndex::GetDirectories(const std::string& rootPath) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto it = trees.find(rootPath);
+        if (it == trees.end())
+            return {};
+
+        std::vector<std::string> directories;
+        for (const auto& [directory, indexed] : it->second.directories)
+        {
+            if (directory == rootPath || !indexed.scripts.empty())
+                directories.emplace_back(directory);
+        }
+
+        return directories;
+    }
+
+    std::optional<FileFingerprint> ScriptIndex::GetFingerprint(const std::string& scriptPath) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        for (const auto& [rootPath, tree] : trees)
+        {
+            auto it = tree.scripts.find(scriptPath);
+            if (it != tree.scripts.end())
+                return it->second;
+        }
+
+        return std::nullopt;
+    }
+
+    std::vector<std::string> ScriptIndex::GetScriptsUnder(const std::string& directory) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        std::string prefix = directory + static_cast<char>(std::filesystem::path::preferred_separator);
+        std::vector<std::string> scripts;
+
+        for (const auto& [rootPath, tree] : trees)
+        {
+            for (auto it = tree.scripts.lower_bound(prefix); it != tree.scripts.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it)
+                scripts.emplace_back(it->first);
+        }
+
+        return scripts;
+    }
+
+    std::optional<std::string> ScriptIndex::ResolveModule(const std::string& moduleName) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (moduleNamesDirty)
+        {
+            BuildModuleNames();
+        }
+
+        auto it = moduleNames.find(moduleName);
+        if (it == moduleNames.end())
+            return std::nullopt;
+
+        return it->second;
+    }
+
+    void ScriptIndex::BuildModuleNames() const
+    {
+        moduleNames.clear();
+
+        for (const auto& [rootPath, tree] : packTrees)
+            AddModuleNames(rootPath, tree);
+
+        for (const auto& [rootPath, tree] : trees)
+            AddModuleNames(rootPath, tree);
+
+        moduleNamesDirty = false;
+    }
+
+    void ScriptIndex::AddModuleNames(const std::string& rootPath, const IndexedTree& tree) const
+    {
+        // Same precedence as the package.path built by LuaPathManager: directories in order,
+        // then extensions in pattern order, the first script found for a name wins
+        static constexpr const char* EXTENSIONS[] = { ".ext", ".lua", ".out", ".moon" };
+
+        for (const auto& [directory, indexed] : tree.directories)
+        {
+            if (directory != rootPath && indexed.scripts.empty())
+                continue;
+
+            std::string prefix = directory + static_cast<char>(std::filesystem::path::preferred_separator);
+
+            for (const char* extension : EXTENSIONS)
+            {
+                std::string_view suffix(extension);
+
+                for (auto it = tree.scripts.lower_bound(prefix); it != tree.scripts.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it)
+                {
+                    const std::string& scriptPath = it->first;
+                    if (scriptPath.size() <= prefix.size() + suffix.size() || scriptPath.compare(scriptPath.size() - suffix.size(), suffix.size(), suffix) != 0)
+                        continue;
+
+                    std::string name = scriptPath.substr(prefix.size(), scriptPath.size() - prefix.size() - suffix.size());
+
+                    // require maps dots to separators, a dotted file name is unreachable
+                    if (name.find('.') != std::string::npos)
+                        continue;
+
+                    std::replace(name.begin(), name.end(), '\\', '.');
+                    std::replace(name.begin(), name.end(), '/', '.');
+                    moduleNames.emplace(std::move(name), scriptPath);
+                }
+            }
+        }
+    }
+
+    void ScriptIndex::SetPackScripts(const std::string& rootPath, const std::vector<std::string>& scripts)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        IndexedTree tree;
+        tree.directories[rootPath];
+        for (const auto& scriptPath : scripts)
+        {
+            tree.directories[std::filesystem::path(scriptPath).parent_path().string()].scripts.push_back(scriptPath);
+            tree.scripts.emplace(scriptPath, FileFingerprint{});
+        }
+
+        packTrees[rootPath] = std::move(tree);
+        moduleNamesDirty = true;
+    }
+
+    void ScriptIndex::UpdateScript(const std::string& scriptPath, const FileFingerprint& fingerprint)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        for (auto& [rootPath, tree] : trees)
+        {
+            auto it = tree.scripts.find(scriptPath);
+            if (it != tree.scripts.end())
+                it->second = fingerprint;
+        }
+    }
+
+    void ScriptIndex::RemoveScript(const std::string& scriptPath)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        std::string directory = std::filesystem::path(scriptPath).parent_path().string();
+        for (auto& [rootPath, tree] : trees)
+        {
+            if (!tree.scripts.erase(scriptPath))
+                continue;
+
+            moduleNamesDirty = true;
+
+            // Listed again on the next refresh, whatever else moved in the directory
+            auto it = tree.directories.find(directory);
+            if (it != tree.directories.end())
+            {
+                std::erase(it->second.scripts, scriptPath);
+                it->second.mtime = 0;
+            }
+        }
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef ECLIPSE_SCRIPT_INDEX_HPP
+#define ECLIPSE_SCRIPT_INDEX_HPP
+
+#include "EclipseIncludes.hpp"
+#include "FileFingerprint.hpp"
+
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Eclipse
+{
+    // Scripts and directories of each script root, shared by discovery, require paths
+    // and reload diffing. A refresh only re-lists directories whose mtime changed, the
+    // rest of the tree costs one stat per directory. Fingerprints are the metadata last
+    // observed by a listing or the watcher; LuaCache still decides what was modified.
+    class ScriptIndex
+    {
+    public:
+        static ScriptIndex& GetInstance();
+
+        // False if the root is not a directory
+        bool Refresh(const std::string& rootPath);
+
+        // Sorted by path, the order scripts are executed in
+        std::vector<std::string> GetScripts(const std::string& rootPath) const;
+        // The root and every directory holding at least one script
+        std::vector<std::string> GetDirectories(const std::string& rootPath) const;
+        std::optional<FileFingerprint> GetFingerprint(const std::string& scriptPath) const;
+        // Indexed scripts anywhere below directory, in every root
+        std::vector<std::string> GetScriptsUnder(const std::string& directory) const;
+        // Script that require(moduleName) would find through the require paths
+        std::optional<std::string> ResolveModule(const std::string& moduleName) const;
+
+        // Chunks of a script pack built from rootPath, resolved like the scripts they were
+        // compiled from and ahead of the directory, which a deploy may not ship
+        void SetPackScripts(const std::string& rootPath, const std::vector<std::string>& scripts);
+
+        // Watcher events, keep known entries current between refreshes
+        void UpdateScript(const std::string& scriptPath, const FileFingerprint& fingerprint);
+        void RemoveScript(const std::string& scriptPath);
+
+    private:
+        struct IndexedDirectory
+        {
+            int64 mtime = 0;
+            std::vector<std::string> scripts;
+            std::vector<std::string> subdirectories;
+        };
+
+        struct IndexedTree
+        {
+            std::map<std::string, IndexedDirectory> directories;
+            std::map<std::string, FileFingerprint> scripts;
+        };
+
+        ScriptIndex() = default;
+        ~ScriptIndex() = default;
+        ScriptIndex(const ScriptIndex&) = delete;
+        ScriptIndex& operator=(const ScriptIndex&) = delete;
+
+        static std::optional<int64> GetDirectoryTime(const std::string& directory);
+        void RefreshDirectory(IndexedTree& tree, const std::string& directory);
+        void ListDirectory(IndexedTree& tree, const std::string& directory, IndexedDirectory& indexed);
+        void RemoveDirectory(IndexedTree& tree, const std::string& directory);
+        void BuildModuleNames() const;
+        void AddModuleNames(const std::string& rootPath, const IndexedTree& tree) const;
+
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, IndexedTree> trees;
+        std::unordered_map<std::string, IndexedTree> packTrees;
+
+        // Rebuilt on the first lookup after the tree changed
+        mutable std::unordered_map<std::string, std::string> moduleNames;
+        mutable bool moduleNamesDirty = true;
+    };
+}
+
+#endif // ECLIPSE_SCRIPT_INDEX_HPP
@@ -1,18 +1,26 @@
 #include "ScriptLoader.hpp"
 #include "LuaCache.hpp"
 #include "LuaCompiler.hpp"
+#include "CompilerPool.hpp"
 #include "EclipseLogger.hpp"
+#include "LuaAbi.hpp"
+#include "LineMap.hpp"
+#include "MappedFile.hpp"
+#include "ScriptPackFormat.hpp"
+#include "ScriptIndex.hpp"
+#include "BoundedQueue.hpp"
+#include "ContentHash.hpp"
 
 #include <filesystem>
 #include <algorithm>
-#include <set>
+#include <atomic>
+#include <cstring>
 #include <chrono>
+#include <condition_variable>
 #include <future>
-#include <unordered_map>
-#include <ctime>
 #include <mutex>
 #include <thread>
-#include <boost/filesystem.hpp>
+#include <unordered_map>
 
 namespace Eclipse
 {
@@ -23,91 +31,58 @@ namespace Eclipse
 
     std::vector<std::string> ScriptLoader::DiscoverScripts(const std::string& directoryPath)
     {
-        static std::unordered_map<std::string, std::pair<std::vector<std::string>, std::time_t>> discoverCache;
-
-        if (!boost::filesystem::exists(directoryPath) || !boost::filesystem::is_directory(directoryPath))
+        auto& index = ScriptIndex::GetInstance();
+        if (!index.Refresh(directoryPath))
         {
             EclipseLogger::GetInstance().LogScriptNotFound(directoryPath, true);
             return {};
         }
 
-        auto lastWrite = boost::filesystem::last_write_time(directoryPath);
-        auto it = discoverCache.find(directoryPath);
-        if (it != discoverCache.end() && it->second.second >= lastWrite) {
-            return it->second.first;
-        }
-
-        std::vector<std::string> scripts;
-        scripts.reserve(100);
-
-        try
-        {
-            for (const auto& entry : boost::filesystem::recursive_directory_iterator(directoryPath))
-            {
-                if (boost::filesystem::is_regular_file(entry))
-                {
-                    std::string extension = entry.path().extension().string();
-                    if (IsValidScriptExtension(extension))
-                        scripts.emplace_back(entry.path().string());
-                }
-            }
-
-            std::sort(scripts.begin(), scripts.end());
-
-            discoverCache[directoryPath] = {scripts, lastWrite};
-
-            EclipseLogger::GetInstance().LogDebug("[Boost] Discovered " + std::to_string(scripts.size()) + " scripts in " + directoryPath);
-        }
-        catch (const std::exception& e)
-        {
-            EclipseLogger::GetInstance().LogError("Error discovering scripts in " + directoryPath + ": " + e.what());
-        }
-
+        auto scripts = index.GetScripts(directoryPath);
+        EclipseLogger::GetInstance().LogDebug("Indexed " + std::to_string(scripts.size()) + " scripts in " + directoryPath);
         return scripts;
     }
 
-    std::set<std::string> ScriptLoader::ExtractDirectoriesFromScripts(const std::vector<std::string>& scriptPaths)
+    bool ScriptLoader::LoadBytecodeIntoState(sol::state& targetState, const std::vector<char>& bytecode, const std::string& chunkName)
     {
-        std::set<std::string> directories;
-
-        for (const auto& scriptPath : scriptPaths)
-        {
-            boost::filesystem::path path(scriptPath);
-            std::string parentDir = path.parent_path().string();
-            if (!parentDir.empty())
-            {
-                directories.insert(parentDir);
-            }
-        }
-
-        EclipseLogger::GetInstance().LogDebug("Extracted " + std::to_string(directories.size()) + " unique directories from " + std::to_string(scriptPaths.size()) + " scripts");
-        return directories;
+        return LoadBytecodeIntoState(targetState, bytecode.data(), bytecode.size(), chunkName);
     }
 
-    bool ScriptLoader::LoadBytecodeIntoState(sol::state& targetState, const std::vector<char>& bytecode, const std::string& chunkName)
+    bool ScriptLoader::LoadBytecodeIntoState(sol::state& targetState, const char* data, size_t size, const std::string& chunkName)
     {
         try
         {
             lua_State* L = targetState.lua_state();
+            int base = lua_gettop(L);
 
-            int result = luaL_loadbuffer(L, bytecode.data(), bytecode.size(), chunkName.c_str());
+            lua_pushcfunction(L, TracebackHandler);
+            int result = luaL_loadbuffer(L, data, size, chunkName.c_str());
             if (result != LUA_OK)
             {
                 std::string error = lua_tostring(L, -1);
-                lua_pop(L, 1);
+                lua_settop(L, base);
                 EclipseLogger::GetInstance().LogLuaError(chunkName, "Failed to load bytecode: " + error);
                 return false;
             }
 
-            result = lua_pcall(L, 0, LUA_MULTRET, 0);
+            // Expose the executing chunk so registrations can be attributed to it
+            lua_pushstring(L, chunkName.c_str());
+            lua_setfield(L, LUA_REGISTRYINDEX, ACTIVE_CHUNK_KEY);
+
+            result = lua_pcall(L, 0, 0, base + 1);
+
+            lua_pushnil(L);
+            lua_setfield(L, LUA_REGISTRYINDEX, ACTIVE_CHUNK_KEY);
+
             if (result != LUA_OK)
             {
-                std::string error = lua_tostring(L, -1);
-                lua_pop(L, 1);
+                std::string error = lua_isstring(L, -1) ? lua_tostring(L, -1) : "(error object is not a string)";
+                lua_settop(L, base);
                 EclipseLogger::GetInstance().LogLuaExecutionError(chunkName, error);
                 return false;
             }
 
+            lua_settop(L, base);
             return true;
         }
         catch (const std::exception& e)
@@ -117,6 +92,70 @@ namespace Eclipse
         }
     }
 
+    int ScriptLoader::TracebackHandler(lua_State* L)
+    {
+        std::string message = lua_isstring(L, 1) ? lua_tostring(L, 1) : "(error object is not a string)";
+
+        // Level 0 is this handler
+        message = DescribeError(L, std::move(message), 1);
+        lua_pushstring(L, message.c_str());
+        return 1;
+    }
+
+    std::string ScriptLoader::DescribeError(lua_State* L, std::string message, int firstLevel)
+    {
+        std::string chunkHint = GetActiveChunk(L);
+
+        std::string traceback;
+        std::string firstLocation;
+        lua_Debug ar;
+
+        for (int level = firstLevel; lua_getstack(L, level, &ar); ++level)
+        {
+            lua_getinfo(L, "Sln", &ar);
+
+            std::string location;
+            bool stripped = ar.currentline <= 0 && std::strcmp(ar.what, "Lua") == 0;
+
+            if (stripped)
+            {
+                // Only the line range survives stripping, the map names the script and function
+                location = LineMap::GetInstance().Resolve(chunkHint, ar.linedefined, ar.lastlinedefined);
+                if (location.empty())
+                    location = fmt::format("{}:{}-{}", ar.short_src, ar.linedefined, ar.lastlinedefined);
+            }
+            else if (std::strcmp(ar.what, "main") == 0 && ar.currentline <= 0)
+                location = (chunkHint.empty() ? std::string(ar.short_src) : chunkHint) + " main chunk";
+            else if (ar.currentline > 0)
+                location = fmt::format("{}:{}", ar.short_src, ar.currentline);
+            else
+                location = "[C]";
+
+            if (ar.name && !stripped)
+                location += fmt::format(" in function '{}'", ar.name);
+
+            if (firstLocation.empty() && std::strcmp(ar.what, "C") != 0)
+                firstLocation = location;
+
+            traceback += "\n\t" + location;
+        }
+
+        // Stripped code raises "?:-1: message", point it at the failing function instead
+        if (message.rfind("?:-1:", 0) == 0 && !firstLocation.empty())
+            message = firstLocation + ":" + message.substr(5);
+
+        message += "\nstack traceback:" + traceback;
+        return message;
+    }
+
+    std::string ScriptLoader::GetActiveChunk(lua_State* L)
+    {
+        lua_getfield(L, LUA_REGISTRYINDEX, ACTIVE_CHUNK_KEY);
+        std::string chunkName = lua_isstring(L, -1) ? lua_tostring(L, -1) : "";
+        lua_pop(L, 1);
+        return chunkName;
+    }
+
     bool ScriptLoader::LoadScript(sol::state& targetState, sol::state& compilerState, const std::string& filePath)
     {
         if (!std::filesystem::exists(filePath))
@@ -127,93 +166,357 @@ namespace Eclipse
 
         auto& cache = LuaCache::GetInstance();
 
-        auto cachedBytecode = cache.GetBytecode(filePath);
-        if (cachedBytecode.has_value())
+        if (auto cachedBytecode = cache.GetBytecode(filePath))
         {
             EclipseLogger::GetInstance().LogTrace("Loading script from cache: " + filePath);
-            return LoadBytecodeIntoState(targetState, *cachedBytecode, filePath);
+            return LoadBytecodeIntoState(targetState, cachedBytecode->Data(), cachedBytecode->Size(), filePath);
         }
 
         EclipseLogger::GetInstance().LogTrace("Compiling script: " + filePath);
-        auto bytecode = LuaCompiler::CompileFileTobytecode(compilerState, filePath);
+        FileFingerprint fingerprint;
+        auto bytecode = LuaCompiler::CompileFileTobytecode(compilerState, filePath, fingerprint);
         if (bytecode.empty())
         {
-            cache.StoreBytecode(filePath, std::move(bytecode), false);
+            cache.StoreBytecode(filePath, std::move(bytecode), false, fingerprint);
             return false;
         }
 
         bool success = LoadBytecodeIntoState(targetState, bytecode, filePath);
-        cache.StoreBytecode(filePath, std::move(bytecode), success);
+        cache.StoreBytecode(filePath, std::move(bytecode), success, fingerprint);
 
         return success;
     }
 
-    int ScriptLoader::LoadFiles(sol::state& targetState, sol::state& compilerState, const std::vector<std::string>& files, std::vector<std::string>& loadedScripts, LoadStatistics* stats)
+    int ScriptLoader::LoadFiles(sol::state& targetState, const std::vector<std::string>& files, std::vector<std::string>& loadedScripts, LoadStatistics* stats)
     {
-        int successCount = 0;
+        auto& cache = LuaCache::GetInstance();
+
+        auto precompiled = TakePrecompiled();
+
+        // Everything the cache or the startup precompile cannot serve goes through the read and compile stages
+        std::vector<BytecodeRef> cachedBytecodes(files.size());
+        std::unordered_map<size_t, CompiledSource> compiledOutOfOrder;
+        std::vector<size_t> pendingIndexes;
 
-        for (const auto& file : files)
+        for (size_t i = 0; i < files.size(); ++i)
         {
-            if (stats) stats->total++;
+            cachedBytecodes[i] = cache.GetBytecode(files[i]);
+            if (cachedBytecodes[i])
+                continue;
 
-            if (!std::filesystem::exists(file))
+            // Compiled in the background at startup, again if edited while the world was loading
+            auto it = precompiled.find(files[i]);
+            auto fingerprint = it != precompiled.end() ? FileFingerprint::Stat(files[i]) : std::nullopt;
+            if (fingerprint && fingerprint->SameMetadata(it->second.fingerprint))
             {
-                EclipseLogger::GetInstance().LogScriptNotFound(file, false);
-                if (stats) stats->failed++;
+                CompiledSource compiled;
+                compiled.index = i;
+                compiled.bytecode = std::move(it->second.bytecode);
+                compiled.fingerprint = it->second.fingerprint;
+                compiledOutOfOrder.emplace(i, std::move(compiled));
                 continue;
             }
 
-            auto& cache = LuaCache::GetInstance();
-            bool wasInCache = cache.GetBytecode(file).has_value();
+            pendingIndexes.push_back(i);
+        }
+
+        BoundedQueue<ScriptSource> sources(PIPELINE_DEPTH);
+        BoundedQueue<CompiledSource> compiledSources(PIPELINE_DEPTH);
+        std::unique_ptr<CompileStream> compileStream;
+        std::thread reader;
+        std::atomic<uint64> readTime{ 0 };
+
+        // Position in pendingIndexes reached by the execute stage, the reader stays within
+        // REORDER_WINDOW of it so a slow script cannot pile finished ones up behind it
+        std::mutex windowMutex;
+        std::condition_variable windowMoved;
+        size_t pendingExecuted = 0;
+        bool pipelineStopped = false;
+
+        if (!pendingIndexes.empty())
+        {
+            EclipseLogger::GetInstance().LogDebug("Compiling " + std::to_string(pendingIndexes.size()) + " scripts in parallel");
+
+            compileStream = CompilerPool::GetInstance().StartStream(sources, compiledSources, pendingIndexes.size());
 
-            if (LoadScript(targetState, compilerState, file))
+            // Read stage: prefetches in execution order, held back by the compile queue and the window
+            reader = std::thread([&]()
             {
-                loadedScripts.emplace_back(file);
-                successCount++;
-                EclipseLogger::GetInstance().LogTrace("Successfully loaded script: " + file);
+                for (size_t position = 0; position < pendingIndexes.size(); ++position)
+                {
+                    {
+                        std::unique_lock<std::mutex> lock(windowMutex);
+                        windowMoved.wait(lock, [&] { return pipelineStopped || position < pendingExecuted + REORDER_WINDOW; });
+                        if (pipelineStopped)
+                            break;
+                    }
+
+                    size_t index = pendingIndexes[position];
+                    auto startTime = std::chrono::high_resolution_clock::now();
+                    ScriptSource source = ReadSource(index, files[index]);
+                    readTime += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+                    if (!sources.Push(std::move(source)))
+                        break;
+                }
 
-                if (stats)
+                sources.Close();
+            });
+        }
+
+        auto stopPipeline = [&]()
+        {
+            {
+                std::lock_guard<std::mutex> lock(windowMutex);
+                pipelineStopped = true;
+            }
+            windowMoved.notify_all();
+
+            sources.Close();
+            compiledSources.Close();
+
+            if (reader.joinable())
+                reader.join();
+
+            if (compileStream)
+                compileStream->Join();
+        };
+
+        // Execute stage: sequential, in discovery order. New bytecode is published every
+        // PIPELINE_DEPTH scripts, so require finds modules loaded earlier without a snapshot
+        // copy per script, and the cache is never locked while a script runs.
+        struct PendingStore
+        {
+            std::string file;
+            std::vector<char> bytecode;
+            bool success;
+            FileFingerprint fingerprint;
+        };
+        std::vector<PendingStore> pendingStores;
+        pendingStores.reserve(PIPELINE_DEPTH);
+
+        auto publishPending = [&]()
+        {
+            if (pendingStores.empty())
+                return;
+
+            LuaCache::UpdateScope cacheUpdate;
+            for (auto& store : pendingStores)
+                cache.StoreBytecode(store.file, std::move(store.bytecode), store.success, store.fingerprint);
+            pendingStores.clear();
+        };
+
+        uint64 executeTime = 0;
+        int successCount = 0;
+
+        try
+        {
+            for (size_t i = 0; i < files.size(); ++i)
+            {
+                const auto& file = files[i];
+                if (stats) stats->total++;
+
+                bool compiledNow = !cachedBytecodes[i];
+                CompiledSource compiled;
+
+                if (compiledNow)
                 {
-                    if (wasInCache)
-                        stats->cached++;
+                    // Workers finish out of order, later scripts wait here until their turn
+                    while (!compiledOutOfOrder.count(i))
+                    {
+                        auto next = compiledSources.Pop();
+                        if (!next)
+                            break;
+
+                        compiledOutOfOrder.emplace(next->index, std::move(*next));
+                    }
+
+                    auto it = compiledOutOfOrder.find(i);
+                    if (it == compiledOutOfOrder.end())
+                    {
+                        compiled.missing = true;
+                    }
                     else
                     {
-                        std::filesystem::path path(file);
-                        if (path.extension() == ".out")
-                            stats->precompiled++;
+                        compiled = std::move(it->second);
+                        compiledOutOfOrder.erase(it);
+                    }
+
+                    // Pending indexes are ascending, this one is either the next or a precompiled script
+                    if (pendingExecuted < pendingIndexes.size() && pendingIndexes[pendingExecuted] == i)
+                    {
+                        {
+                            std::lock_guard<std::mutex> lock(windowMutex);
+                            ++pendingExecuted;
+                        }
+                        windowMoved.notify_one();
+                    }
+
+                    if (compiled.missing)
+                    {
+                        EclipseLogger::GetInstance().LogScriptNotFound(file, false);
+                        if (stats) stats->failed++;
+                        continue;
+                    }
+                }
+
+                auto startTime = std::chrono::high_resolution_clock::now();
+                bool success;
+
+                if (compiledNow)
+                {
+                    success = !compiled.bytecode.empty() && LoadBytecodeIntoState(targetState, compiled.bytecode, file);
+                    pendingStores.push_back({ file, std::move(compiled.bytecode), success, compiled.fingerprint });
+                    if (pendingStores.size() >= PIPELINE_DEPTH)
+                        publishPending();
+                }
+                else
+                {
+                    success = LoadBytecodeIntoState(targetState, cachedBytecodes[i]->Data(), cachedBytecodes[i]->Size(), file);
+                }
+
+                executeTime += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+                if (success)
+                {
+                    loadedScripts.emplace_back(file);
+                    successCount++;
+                    EclipseLogger::GetInstance().LogTrace("Successfully loaded script: " + file);
+
+                    if (stats)
+                    {
+                        if (!compiledNow)
+                            stats->cached++;
                         else
-                            stats->compiled++;
+                        {
+                            std::filesystem::path path(file);
+                            if (path.extension() == ".out")
+                                stats->precompiled++;
+                            else
+                                stats->compiled++;
+                        }
                     }
                 }
+                else
+                {
+                    EclipseLogger::GetInstance().LogScriptLoad(file, false);
+                    if (stats) stats->failed++;
+                }
             }
-            else
-            {
-                EclipseLogger::GetInstance().LogScriptLoad(file, false);
-                if (stats) stats->failed++;
-            }
+        }
+        catch (...)
+        {
+            stopPipeline();
+            publishPending();
+            throw;
+        }
+
+        stopPipeline();
+        publishPending();
+
+        if (stats)
+        {
+            stats->readTime += static_cast<uint32>(readTime.load());
+            stats->compileTime += static_cast<uint32>(compileStream ? compileStream->GetBusyTime() : 0);
+            stats->executeTime += static_cast<uint32>(executeTime);
         }
 
         return successCount;
     }
 
-    void ScriptLoader::ProcessSubdirectories(sol::state& targetState, sol::state& compilerState, const std::string& directoryPath, std::vector<std::string>& loadedScripts, LoadStatistics* stats)
+    ScriptSource ScriptLoader::ReadSource(size_t index, const std::string& filePath)
+    {
+        ScriptSource source;
+        source.index = index;
+        source.path = filePath;
+
+        auto fingerprint = FileFingerprint::Stat(filePath);
+        if (!fingerprint)
+        {
+            source.missing = true;
+            return source;
+        }
+
+        source.content = LuaCompiler::ReadFileContent(filePath);
+        fingerprint->contentHash = ContentHash::Compute(source.content.data(), source.content.size());
+        source.fingerprint = *fingerprint;
+        return source;
+    }
+
+    std::mutex ScriptLoader::precompileMutex;
+    std::future<std::unordered_map<std::string, ScriptLoader::PrecompiledScript>> ScriptLoader::precompileResult;
+
+    void ScriptLoader::StartPrecompile(const std::string& directoryPath)
+    {
+        std::lock_guard<std::mutex> lock(precompileMutex);
+        if (precompileResult.valid())
+            return;
+
+        precompileResult = std::async(std::launch::async, [directoryPath]()
+        {
+            auto startTime = std::chrono::high_resolution_clock::now();
+
+            std::unordered_map<std::string, PrecompiledScript> results;
+            auto scripts = DiscoverScripts(directoryPath);
+            if (scripts.empty())
+                return results;
+
+            // Sized for every script, this thread fills the input before it drains the output
+            BoundedQueue<ScriptSource> sources(scripts.size());
+            BoundedQueue<CompiledSource> compiledSources(scripts.size());
+            auto compileStream = CompilerPool::GetInstance().StartStream(sources, compiledSources, scripts.size());
+
+            for (size_t i = 0; i < scripts.size(); ++i)
+            {
+                sources.Push(ReadSource(i, scripts[i]));
+            }
+            sources.Close();
+
+            while (auto compiled = compiledSources.Pop())
+            {
+                if (!compiled->missing)
+                    results.emplace(scripts[compiled->index], PrecompiledScript{ std::move(compiled->bytecode), compiled->fingerprint });
+            }
+            compileStream->Join();
+
+            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - startTime);
+            EclipseLogger::GetInstance().LogDebug("Background compilation of " + std::to_string(results.size()) + " scripts finished in " + std::to_string(duration.count()) + "ms");
+            return results;
+        });
+    }
+
+    std::unordered_map<std::string, ScriptLoader::PrecompiledScript> ScriptLoader::TakePrecompiled()
+    {
+        std::lock_guard<std::mutex> lock(precompileMutex);
+        if (!precompileResult.valid())
+            return {};
+
+        auto startTime = std::chrono::high_resolution_clock::now();
+        auto results = precompileResult.get();
+
+        auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - startTime);
+        EclipseLogger::GetInstance().LogDebug("Waited " + std::to_string(waited.count()) + "ms for background compilation");
+        return results;
+    }
+
+    void ScriptLoader::ProcessSubdirectories(sol::state& targetState, const std::string& directoryPath, std::vector<std::string>& loadedScripts, LoadStatistics* stats)
     {
         auto scripts = DiscoverScripts(directoryPath);
         if (!scripts.empty())
         {
             EclipseLogger::GetInstance().LogDebug("Loading " + std::to_string(scripts.size()) + " scripts from directory: " + directoryPath);
-            int loaded = LoadFiles(targetState, compilerState, scripts, loadedScripts, stats);
+            int loaded = LoadFiles(targetState, scripts, loadedScripts, stats);
             EclipseLogger::GetInstance().LogDebug("Successfully loaded " + std::to_string(loaded) + "/" + std::to_string(scripts.size()) + " scripts from " + directoryPath);
         }
     }
 
-    bool ScriptLoader::LoadDirectory(sol::state& targetState, sol::state& compilerState, const std::string& directoryPath, std::vector<std::string>& loadedScripts, LoadStatistics* stats)
+    bool ScriptLoader::LoadDirectory(sol::state& targetState, const std::string& directoryPath, std::vector<std::string>& loadedScripts, LoadStatistics* stats)
     {
         try
         {
             auto startTime = std::chrono::high_resolution_clock::now();
 
-            ProcessSubdirectories(targetState, compilerState, directoryPath, loadedScripts, stats);
+            ProcessSubdirectories(targetState, directoryPath, loadedScripts, stats);
 
             auto endTime = std::chrono::high_resolution_clock::now();
             auto duration = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime);
@@ -221,6 +524,8 @@ namespace Eclipse
             if (stats)
             {
                 stats->duration = static_cast<uint32>(duration.count());
+                EclipseLogger::GetInstance().LogDebug(fmt::format("Load stages: read {} us, compile {} us, execute {} us, total {} us",
+                    stats->readTime, stats->compileTime, stats->executeTime, stats->duration));
             }
 
             return !loadedScripts.empty();
@@ -231,4 +536,76 @@ namespace Eclipse
             return false;
         }
     }
-}
\ No newline at end of file
+
+    bool ScriptLoader::LoadPack(sol::state& targetState, const std::string& packPath, const std::string& rootPath, std::vector<std::string>& loadedScripts, LoadStatistics* stats)
+    {
+        auto startTime = std::chrono::high_resolution_clock::now();
+
+        auto pack = MappedFile::Open(packPath);
+        if (!pack)
+        {
+            EclipseLogger::GetInstance().LogError("Cannot open script pack: " + packPath);
+            return false;
+        }
+
+        std::vector<ScriptPackFormat::PackedChunk> chunks;
+        std::string error;
+        if (!ScriptPackFormat::Parse(pack->Data(), pack->Size(), GetLuaAbiTag(), chunks, error))
+        {
+            EclipseLogger::GetInstance().LogError("Invalid script pack " + packPath + ": " + error);
+            return false;
+        }
+
+        EclipseLogger::GetInstance().LogDebug("Loading " + std::to_string(chunks.size()) + " scripts from pack: " + packPath);
+
+        auto& cache = LuaCache::GetInstance();
+        std::vector<std::shared_ptr<const BytecodeBuffer>> buffers;
+        std::vector<std::string> chunkNames;
+        buffers.reserve(chunks.size());
+        chunkNames.reserve(chunks.size());
+
+        // Every chunk is published before any runs, require then finds a module wherever it sits in the load order
+        {
+            LuaCache::UpdateScope cacheUpdate;
+            for (const auto& chunk : chunks)
+            {
+                // Every entry holds the mapping, it is unmapped once no snapshot references the pack
+                auto& bytecode = buffers.emplace_back(std::make_shared<const BytecodeBuffer>(chunk.data, chunk.size, pack));
+                auto& chunkName = chunkNames.emplace_back(chunk.name);
+
+                // Packed scripts have no source on disk, an empty fingerprint never matches one
+                cache.StoreBytecode(chunkName, bytecode, true, FileFingerprint{});
+            }
+        }
+        ScriptIndex::GetInstance().SetPackScripts(rootPath, chunkNames);
+
+        for (size_t i = 0; i < chunks.size(); ++i)
+        {
+            std::string& chunkName = chunkNames[i];
+            if (stats) stats->total++;
+
+            bool success = LoadBytecodeIntoState(targetState, buffers[i]->Data(), buffers[i]->Size(), chunkName);
+            if (!success)
+                cache.StoreBytecode(chunkName, std::move(buffers[i]), false, FileFingerprint{});
+
+            if (success)
+            {
+                loadedScripts.emplace_back(std::move(chunkName));
+                if (stats) stats->precompiled++;
+            }
+            else
+            {
+                EclipseLogger::GetInstance().LogScriptLoad(chunkName, false);
+                if (stats) stats->failed++;
+            }
+        }
+
+        if (stats)
+        {
+            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - startTime);
+            stats->duration = static_cast<uint32>(duration.count());
+        }
+
+        return true;
+    }
+}
@@ -3,10 +3,14 @@
 
 #include "EclipseIncludes.hpp"
 #include "LuaPathManager.hpp"
+#include "CompilerPool.hpp"
+#include "FileFingerprint.hpp"
 
+#include <future>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
-#include <set>
 
 namespace Eclipse
 {
@@ -19,31 +23,86 @@ namespace Eclipse
         int failed = 0;
         uint32 duration = 0;
 
+        // Busy time of each load stage in microseconds; reads and compiles overlap
+        // execution, so they may add up to more than duration
+        uint32 readTime = 0;
+        uint32 compileTime = 0;
+        uint32 executeTime = 0;
+
         int GetSuccessful() const { return compiled + cached + precompiled; }
     };
 
+    // Bytecode compiled ahead of execution, used to build states off the world thread
+    struct CompiledScript
+    {
+        std::string path;
+        std::vector<char> bytecode;
+        FileFingerprint fingerprint;
+
+        CompiledScript(std::string scriptPath, std::vector<char>&& data, const FileFingerprint& sourceFingerprint)
+            : path(std::move(scriptPath)), bytecode(std::move(data)), fingerprint(sourceFingerprint) {}
+    };
+
     class ScriptLoader
     {
     public:
         // Script discovery and loading orchestration
         static bool LoadScript(sol::state& targetState, sol::state& compilerState, const std::string& filePath);
-        static bool LoadDirectory(sol::state& targetState, sol::state& compilerState, const std::string& directoryPath, std::vector<std::string>& loadedScripts, LoadStatistics* stats = nullptr);
+        static bool LoadDirectory(sol::state& targetState, const std::string& directoryPath, std::vector<std::string>& loadedScripts, LoadStatistics* stats = nullptr);
+        // Executes a script pack in place, false if it cannot be used and nothing was loaded.
+        // rootPath is the directory the pack was built from, require resolves its chunks against it
+        static bool LoadPack(sol::state& targetState, const std::string& packPath, const std::string& rootPath, std::vector<std::string>& loadedScripts, LoadStatistics* stats = nullptr);
+
+        // Compiles a directory on a background thread before any state exists; the next
+        // LoadFiles waits for it and executes the results still matching their files
+        static void StartPrecompile(const std::string& directoryPath);
 
         // File discovery utilities
         static std::vector<std::string> DiscoverScripts(const std::string& directoryPath);
-        static std::set<std::string> ExtractDirectoriesFromScripts(const std::vector<std::string>& scriptPaths);
         static bool IsValidScriptExtension(const std::string& extension);
 
         // Bytecode loading utility (public for LuaEngine use)
         static bool LoadBytecodeIntoState(sol::state& targetState, const std::vector<char>& bytecode, const std::string& chunkName);
+        // Loads straight from the given memory, used with shared cache buffers
+        static bool LoadBytecodeIntoState(sol::state& targetState, const char* data, size_t size, const std::string& chunkName);
+
+        // Name of the chunk currently executing its main body, empty outside of script loading
+        static std::string GetActiveChunk(lua_State* L);
+
+        // Message handler adding a traceback, stripped frames are resolved through LineMap.
+        // Every state installs it as the default handler of its protected calls.
+        static int TracebackHandler(lua_State* L);
+        // The same for an error L no longer runs, such as a coroutine that died, from stack level firstLevel
+        static std::string DescribeError(lua_State* L, std::string message, int firstLevel = 0);
 
     private:
+        static constexpr const char* ACTIVE_CHUNK_KEY = "eclipse.active_chunk";
+        // Scripts allowed in each queue between load stages
+        static constexpr size_t PIPELINE_DEPTH = 32;
+        // Scripts the read stage may run ahead of execution, bounds the reorder buffer
+        static constexpr size_t REORDER_WINDOW = PIPELINE_DEPTH * 4;
+
+        struct PrecompiledScript
+        {
+            std::vector<char> bytecode;
+            FileFingerprint fingerprint;
+        };
+
+        // Content and fingerprint of a script, missing if it is not a regular file
+        static ScriptSource ReadSource(size_t index, const std::string& filePath);
+        // Joins the background precompile, empty if none was started
+        static std::unordered_map<std::string, PrecompiledScript> TakePrecompiled();
+
+        static std::mutex precompileMutex;
+        static std::future<std::unordered_map<std::string, PrecompiledScript>> precompileResult;
+
         ScriptLoader() = delete;
         ~ScriptLoader() = default;
         ScriptLoader(const ScriptLoader&) = delete;
         ScriptLoader& operator=(const ScriptLoader&) = delete;
-        static int LoadFiles(sol::state& targetState, sol::state& compilerState, const std::vector<std::string>& files, std::vector<std::string>& loadedScripts, LoadStatistics* stats = nullptr);
-        static void ProcessSubdirectories(sol::state& targetState, sol::state& compilerState, const std::string& directoryPath, std::vector<std::string>& loadedScripts, LoadStatistics* stats = nullptr);
+        // Reads and compiles uncached files ahead of execution, scripts still run in order
+        static int LoadFiles(sol::state& targetState, const std::vector<std::string>& files, std::vector<std::string>& loadedScripts, LoadStatistics* stats = nullptr);
+        static void ProcessSubdirectories(sol::state& targetState, const std::string& directoryPath, std::vector<std::string>& loadedScripts, LoadStatistics* stats = nullptr);
     };
 }
 
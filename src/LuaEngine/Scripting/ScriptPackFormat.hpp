@@ -0,0 +1,182 @@
+#ifndef ECLIPSE_SCRIPT_PACK_FORMAT_HPP
+#define ECLIPSE_SCRIPT_PACK_FORMAT_HPP
+
+#include "ContentHash.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Eclipse
+{
+    // Single-file bundle of compiled scripts, written by eclipse-luac and mapped by the
+    // server. Shared by both, so it must not depend on the core.
+    //
+    // Layout: PackHeader | PackIndexEntry[entryCount] | chunk names | bytecode blobs
+    // Entries are stored in load order, all offsets are from the start of the file.
+    namespace ScriptPackFormat
+    {
+        constexpr char MAGIC[8] = { 'E', 'C', 'L', 'P', 'A', 'C', 'K', '\0' };
+        constexpr uint32_t VERSION = 1;
+
+        struct PackHeader
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t entryCount;
+            uint64_t abiHash;
+            uint64_t indexOffset;
+            uint64_t dataOffset;
+            uint64_t totalSize;
+        };
+
+        struct PackIndexEntry
+        {
+            uint64_t nameOffset;
+            uint32_t nameLength;
+            uint32_t loadOrder;
+            uint64_t dataOffset;
+            uint64_t dataSize;
+            uint64_t dataHash;
+        };
+
+        struct PackedChunk
+        {
+            std::string_view name;
+            const char* data;
+            size_t size;
+        };
+
+        // True when [offset, offset + length) lies within size, written so it cannot overflow
+        inline bool InBounds(uint64_t offset, uint64_t length, uint64_t size)
+        {
+            return offset <= size && length <= size - offset;
+        }
+
+        struct ChunkSource
+        {
+            std::string name;
+            std::vector<char> bytecode;
+        };
+
+        inline uint64_t HashAbi(const std::string& abiTag)
+        {
+            return ContentHash::Compute(abiTag);
+        }
+
+        // Writes the chunks in the given order, returns false on I/O failure
+        inline bool Write(const std::string& packPath, const std::vector<ChunkSource>& chunks, const std::string& abiTag)
+        {
+            PackHeader header{};
+            std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+            header.version = VERSION;
+            header.entryCount = static_cast<uint32_t>(chunks.size());
+            header.abiHash = HashAbi(abiTag);
+            header.indexOffset = sizeof(PackHeader);
+
+            std::vector<PackIndexEntry> index(chunks.size());
+            uint64_t offset = header.indexOffset + sizeof(PackIndexEntry) * chunks.size();
+
+            for (size_t i = 0; i < chunks.size(); ++i)
+            {
+                index[i].nameOffset = offset;
+                index[i].nameLength = static_cast<uint32_t>(chunks[i].name.size());
+                index[i].loadOrder = static_cast<uint32_t>(i);
+                offset += chunks[i].name.size();
+            }
+
+            header.dataOffset = offset;
+            for (size_t i = 0; i < chunks.size(); ++i)
+            {
+                index[i].dataOffset = offset;
+                index[i].dataSize = chunks[i].bytecode.size();
+                index[i].dataHash = ContentHash::Compute(chunks[i].bytecode.data(), chunks[i].bytecode.size());
+                offset += chunks[i].bytecode.size();
+            }
+            header.totalSize = offset;
+
+            // Same publish-by-rename as the bytecode cache, a running server never maps a partial pack
+            std::string tempPath = packPath + ".tmp";
+            {
+                std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+                file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                file.write(reinterpret_cast<const char*>(index.data()), sizeof(PackIndexEntry) * index.size());
+                for (const auto& chunk : chunks)
+                    file.write(chunk.name.data(), chunk.name.size());
+                for (const auto& chunk : chunks)
+                    file.write(chunk.bytecode.data(), chunk.bytecode.size());
+
+                if (!file)
+                    return false;
+            }
+
+            std::remove(packPath.c_str());
+            return std::rename(tempPath.c_str(), packPath.c_str()) == 0;
+        }
+
+        // Validates a mapped pack and returns its chunks in load order, error is set on failure
+        inline bool Parse(const char* base, size_t size, const std::string& abiTag, std::vector<PackedChunk>& chunks, std::string& error)
+        {
+            if (size < sizeof(PackHeader))
+            {
+                error = "file too small";
+                return false;
+            }
+
+            PackHeader header;
+            std::memcpy(&header, base, sizeof(header));
+
+            if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION)
+            {
+                error = "not a script pack or unsupported version";
+                return false;
+            }
+
+            if (header.abiHash != HashAbi(abiTag))
+            {
+                error = "built for a different Lua version (" + abiTag + " expected)";
+                return false;
+            }
+
+            if (header.totalSize != size || header.indexOffset > size
+                || header.entryCount > (size - header.indexOffset) / sizeof(PackIndexEntry))
+            {
+                error = "truncated file";
+                return false;
+            }
+
+            chunks.assign(header.entryCount, PackedChunk{});
+            std::vector<bool> filled(header.entryCount, false);
+            for (uint32_t i = 0; i < header.entryCount; ++i)
+            {
+                PackIndexEntry entry;
+                std::memcpy(&entry, base + header.indexOffset + sizeof(PackIndexEntry) * i, sizeof(entry));
+
+                // A duplicate load order would leave another slot empty
+                if (entry.loadOrder >= header.entryCount || filled[entry.loadOrder] || !InBounds(entry.nameOffset, entry.nameLength, size) || !InBounds(entry.dataOffset, entry.dataSize, size))
+                {
+                    error = "corrupt index entry " + std::to_string(i);
+                    return false;
+                }
+
+                const char* data = base + entry.dataOffset;
+                if (ContentHash::Compute(data, entry.dataSize) != entry.dataHash)
+                {
+                    error = "checksum mismatch for " + std::string(base + entry.nameOffset, entry.nameLength);
+                    return false;
+                }
+
+                filled[entry.loadOrder] = true;
+                chunks[entry.loadOrder] = PackedChunk{ std::string_view(base + entry.nameOffset, entry.nameLength), data, entry.dataSize };
+            }
+
+            return true;
+        }
+    }
+}
+
+#endif // ECLIPSE_SCRIPT_PACK_FORMAT_HPP
@@ -0,0 +1,288 @@
+#include "ScriptWatcher.hpp"
+#include "ScriptLoader.hpp"
+#include "ScriptIndex.hpp"
+#include "CompilerPool.hpp"
+#include "EclipseConfig.hpp"
+#include "EclipseLogger.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <utility>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace Eclipse
+{
+    ScriptWatcher& ScriptWatcher::GetInstance()
+    {
+        static ScriptWatcher instance;
+        return instance;
+    }
+
+    ScriptWatcher::~ScriptWatcher()
+    {
+        Stop();
+    }
+
+    bool ScriptWatcher::Start(const std::string& rootPath)
+    {
+        if (IsRunning())
+            return true;
+
+#ifdef __linux__
+        inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotifyFd < 0)
+        {
+            EclipseLogger::GetInstance().LogError("Script watcher: inotify_init1 failed");
+            return false;
+        }
+
+        AddWatchRecursive(rootPath, nullptr);
+        if (watchedDirectories.empty())
+        {
+            close(inotifyFd);
+            inotifyFd = -1;
+            EclipseLogger::GetInstance().LogError("Script watcher: could not watch " + rootPath);
+            return false;
+        }
+
+        running.store(true, std::memory_order_release);
+        watcherThread = std::thread(&ScriptWatcher::Run, this, EclipseConfig::GetInstance().GetScriptWatcherDebounce());
+
+        EclipseLogger::GetInstance().LogInfo("Script watcher started on " + std::to_string(watchedDirectories.size()) + " directories");
+        return true;
+#else
+        EclipseLogger::GetInstance().LogWarn("Script watcher is only supported on Linux, use .reload eclipse instead");
+        return false;
+#endif
+    }
+
+    void ScriptWatcher::Stop()
+    {
+        running.store(false, std::memory_order_release);
+
+        if (watcherThread.joinable())
+            watcherThread.join();
+
+#ifdef __linux__
+        if (inotifyFd >= 0)
+        {
+            close(inotifyFd);
+            inotifyFd = -1;
+        }
+#endif
+        watchedDirectories.clear();
+    }
+
+    std::vector<WatchedScriptChange> ScriptWatcher::TakeCompiledChanges()
+    {
+        std::lock_guard<std::mutex> lock(changesMutex);
+        return std::exchange(compiledChanges, {});
+    }
+
+    void ScriptWatcher::Run(uint32 debounceTime)
+    {
+#ifdef __linux__
+        std::set<std::string> pendingScripts;
+
+        while (running.load(std::memory_order_acquire))
+        {
+            // Once something is pending, a quiet period of debounceTime ends the burst
+            pollfd descriptor{ inotifyFd, POLLIN, 0 };
+            int timeout = pendingScripts.empty() ? IDLE_POLL_INTERVAL : static_cast<int>(debounceTime);
+
+            int ready = poll(&descriptor, 1, timeout);
+            if (ready > 0 && (descriptor.revents & POLLIN))
+            {
+                ReadEvents(pendingScripts);
+                continue;
+            }
+
+            if (!pendingScripts.empty())
+                CompilePending(pendingScripts);
+        }
+#else
+        (void)debounceTime;
+#endif
+    }
+
+    void ScriptWatcher::AddWatchRecursive(const std::string& directory, std::set<std::string>* discoveredScripts)
+    {
+#ifdef __linux__
+        constexpr uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_MOVE_SELF | IN_ONLYDIR;
+
+        std::error_code ec;
+        if (!std::filesystem::is_directory(directory, ec))
+            return;
+
+        int wd = inotify_add_watch(inotifyFd, directory.c_str(), WATCH_MASK);
+        if (wd < 0)
+        {
+            EclipseLogger::GetInstance().LogWarn("Script watcher: cannot watch " + directory);
+            return;
+        }
+        watchedDirectories[wd] = directory;
+
+        for (const auto& entry : std::filesystem::directory_iterator(directory, ec))
+        {
+            std::string path = entry.path().string();
+            if (entry.is_directory(ec))
+                AddWatchRecursive(path, discoveredScripts);
+            else if (discoveredScripts && ScriptLoader::IsValidScriptExtension(entry.path().extension().string()))
+                discoveredScripts->insert(path);
+        }
+#else
+        (void)directory;
+        (void)discoveredScripts;
+#endif
+    }
+
+    void ScriptWatcher::RemoveWatchRecursive(const std::string& directory, std::set<std::string>& pendingScripts)
+    {
+#ifdef __linux__
+        for (auto& scriptPath : ScriptIndex::GetInstance().GetScriptsUnder(directory))
+            pendingScripts.insert(std::move(scriptPath));
+
+        std::string prefix = directory + '/';
+        for (auto it = watchedDirectories.begin(); it != watchedDirectories.end(); )
+        {
+            if (it->second == directory || it->second.compare(0, prefix.size(), prefix) == 0)
+            {
+                inotify_rm_watch(inotifyFd, it->first);
+                it = watchedDirectories.erase(it);
+            }
+            else
+                ++it;
+        }
+#else
+        (void)directory;
+        (void)pendingScripts;
+#endif
+    }
+
+    void ScriptWatcher::ReadEvents(std::set<std::string>& pendingScripts)
+    {
+#ifdef __linux__
+        alignas(inotify_event) char buffer[16 * 1024];
+
+        for (;;)
+        {
+            ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+            if (length <= 0)
+                break;
+
+            for (char* cursor = buffer; cursor < buffer + length; )
+            {
+                const auto* event = reinterpret_cast<const inotify_event*>(cursor);
+                cursor += sizeof(inotify_event) + event->len;
+
+                if (event->mask & IN_Q_OVERFLOW)
+                {
+                    EclipseLogger::GetInstance().LogWarn("Script watcher: event queue overflowed, run .reload eclipse to catch up");
+                    continue;
+                }
+
+                auto directoryIt = watchedDirectories.find(event->wd);
+                if (directoryIt == watchedDirectories.end())
+                    continue;
+
+                if (event->mask & IN_IGNORED)
+                {
+                    watchedDirectories.erase(directoryIt);
+                    continue;
+                }
+
+                // The watched directory itself was moved, its descriptor would keep the old path
+                if (event->mask & IN_MOVE_SELF)
+                {
+                    std::error_code ec;
+                    if (!std::filesystem::is_directory(directoryIt->second, ec))
+                        RemoveWatchRecursive(std::string(directoryIt->second), pendingScripts);
+                    continue;
+                }
+
+                if (!event->len)
+                    continue;
+
+                std::filesystem::path path = std::filesystem::path(directoryIt->second) / event->name;
+
+                if (event->mask & IN_ISDIR)
+                {
+                    // A directory created or moved in brings its scripts along
+                    if (event->mask & (IN_CREATE | IN_MOVED_TO))
+                    {
+                        AddWatchRecursive(path.string(), &pendingScripts);
+                    }
+                    // Moved out or deleted as a whole, its scripts leave with it
+                    else if (event->mask & (IN_MOVED_FROM | IN_DELETE))
+                    {
+                        RemoveWatchRecursive(path.string(), pendingScripts);
+                    }
+                    continue;
+                }
+
+                if (!ScriptLoader::IsValidScriptExtension(path.extension().string()))
+                    continue;
+
+                // IN_CREATE alone is an empty file, its IN_CLOSE_WRITE follows
+                if (event->mask & IN_CREATE)
+                    continue;
+
+                pendingScripts.insert(path.string());
+            }
+        }
+#else
+        (void)pendingScripts;
+#endif
+    }
+
+    void ScriptWatcher::CompilePending(std::set<std::string>& pendingScripts)
+    {
+        std::vector<WatchedScriptChange> changes;
+        std::vector<std::string> existingScripts;
+
+        for (const auto& scriptPath : pendingScripts)
+        {
+            if (FileFingerprint::Stat(scriptPath))
+            {
+                existingScripts.push_back(scriptPath);
+            }
+            else
+            {
+                ScriptIndex::GetInstance().RemoveScript(scriptPath);
+
+                WatchedScriptChange change;
+                change.path = scriptPath;
+                change.removed = true;
+                changes.push_back(std::move(change));
+            }
+        }
+        pendingScripts.clear();
+
+        // Fingerprints are taken before each source is read, an edit racing the compile then shows as a change
+        std::vector<FileFingerprint> fingerprints;
+        auto compiled = CompilerPool::GetInstance().CompileAll(existingScripts, fingerprints);
+        for (size_t i = 0; i < existingScripts.size(); ++i)
+        {
+            ScriptIndex::GetInstance().UpdateScript(existingScripts[i], fingerprints[i]);
+
+            WatchedScriptChange change;
+            change.path = std::move(existingScripts[i]);
+            change.bytecode = std::move(compiled[i]);
+            change.fingerprint = fingerprints[i];
+            changes.push_back(std::move(change));
+        }
+
+        EclipseLogger::GetInstance().LogDebug("Script watcher: " + std::to_string(changes.size()) + " changes ready for the next tick");
+
+        std::lock_guard<std::mutex> lock(changesMutex);
+        for (auto& change : changes)
+        {
+            compiledChanges.push_back(std::move(change));
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef ECLIPSE_SCRIPT_WATCHER_HPP
+#define ECLIPSE_SCRIPT_WATCHER_HPP
+
+#include "EclipseIncludes.hpp"
+#include "FileFingerprint.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Eclipse
+{
+    // Script change picked up by the watcher, compiled and waiting for the world tick
+    struct WatchedScriptChange
+    {
+        std::string path;
+        std::vector<char> bytecode; // empty when the script was removed or failed to compile
+        FileFingerprint fingerprint; // taken before compiling
+        bool removed = false;
+    };
+
+    // Watches the script tree with inotify (Linux only). Bursts of changes are debounced
+    // and compiled on the watcher thread, the world thread only executes the results.
+    class ScriptWatcher
+    {
+    public:
+        static ScriptWatcher& GetInstance();
+
+        bool Start(const std::string& rootPath);
+        void Stop();
+        bool IsRunning() const { return running.load(std::memory_order_acquire); }
+
+        std::vector<WatchedScriptChange> TakeCompiledChanges();
+
+    private:
+        ScriptWatcher() = default;
+        ~ScriptWatcher();
+        ScriptWatcher(const ScriptWatcher&) = delete;
+        ScriptWatcher& operator=(const ScriptWatcher&) = delete;
+
+        static constexpr int IDLE_POLL_INTERVAL = 500;
+
+        std::thread watcherThread;
+        std::atomic<bool> running{ false };
+
+        std::mutex changesMutex;
+        std::vector<WatchedScriptChange> compiledChanges;
+
+        // Owned by the watcher thread while running
+        int inotifyFd = -1;
+        std::unordered_map<int, std::string> watchedDirectories;
+
+        void Run(uint32 debounceTime);
+        void AddWatchRecursive(const std::string& directory, std::set<std::string>* discoveredScripts);
+        // Directory moved out or deleted: its scripts are queued, they no longer exist and get unloaded
+        void RemoveWatchRecursive(const std::string& directory, std::set<std::string>& pendingScripts);
+        void ReadEvents(std::set<std::string>& pendingScripts);
+        void CompilePending(std::set<std::string>& pendingScripts);
+    };
+}
+
+#endif // ECLIPSE_SCRIPT_WATCHER_HPP
@@ -0,0 +1,130 @@
+#include "TableSnapshots.hpp"
+#include "LuaSerializer.hpp"
+#include "EclipseLogger.hpp"
+
+namespace Eclipse
+{
+    TableSnapshots& TableSnapshots::GetInstance()
+    {
+        static TableSnapshots instance;
+        return instance;
+    }
+
+    void TableSnapshots::Mark(lua_State* L, const std::string& name, int index)
+    {
+        if (index < 0 && index > LUA_REGISTRYINDEX)
+            index = lua_gettop(L) + index + 1;
+
+        lua_getfield(L, LUA_REGISTRYINDEX, MARKED_KEY);
+        if (!lua_istable(L, -1))
+        {
+            lua_pop(L, 1);
+            lua_newtable(L);
+            lua_pushvalue(L, -1);
+            lua_setfield(L, LUA_REGISTRYINDEX, MARKED_KEY);
+        }
+
+        lua_pushvalue(L, index);
+        lua_setfield(L, -2, name.c_str());
+        lua_pop(L, 1);
+    }
+
+    TableSnapshots::SnapshotMap TableSnapshots::Collect(lua_State* L)
+    {
+        SnapshotMap published;
+
+        lua_getfield(L, LUA_REGISTRYINDEX, MARKED_KEY);
+        if (lua_istable(L, -1))
+        {
+            int marked = lua_gettop(L);
+
+            lua_pushnil(L);
+            while (lua_next(L, marked))
+            {
+                std::string name = lua_tostring(L, -2);
+                std::string data;
+                std::string error;
+
+                if (LuaSerializer::Serialize(L, -1, data, &error))
+                    published.emplace(std::move(name), std::make_shared<const std::string>(std::move(data)));
+                else
+                    EclipseLogger::GetInstance().LogError("Snapshot '" + name + "' cannot be shared with other states: " + error);
+
+                lua_pop(L, 1);
+            }
+        }
+        lua_pop(L, 1);
+
+        // Marks are taken once, a reload marks its tables again
+        lua_pushnil(L);
+        lua_setfield(L, LUA_REGISTRYINDEX, MARKED_KEY);
+
+        size_t totalSize = 0;
+        for (const auto& [name, data] : published)
+            totalSize += data->size();
+
+        if (!published.empty())
+            EclipseLogger::GetInstance().LogDebug("Published " + std::to_string(published.size()) + " table snapshots (" + std::to_string(totalSize) + " bytes)");
+
+        return published;
+    }
+
+    void TableSnapshots::Publish(lua_State* L, bool fullLoad)
+    {
+        SnapshotMap published = Collect(L);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (fullLoad)
+        {
+            snapshots = std::move(published);
+            return;
+        }
+
+        for (auto& [name, data] : published)
+            snapshots.insert_or_assign(name, std::move(data));
+    }
+
+    void TableSnapshots::PublishStaged(lua_State* L)
+    {
+        SnapshotMap published = Collect(L);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        stagedSnapshots = std::move(published);
+    }
+
+    void TableSnapshots::CommitStaged()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        snapshots = std::move(stagedSnapshots);
+        stagedSnapshots.clear();
+    }
+
+    void TableSnapshots::DiscardStaged()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stagedSnapshots.clear();
+    }
+
+    bool TableSnapshots::Push(lua_State* L, const std::string& name, bool staged) const
+    {
+        std::shared_ptr<const std::string> data;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            const SnapshotMap& source = staged ? stagedSnapshots : snapshots;
+            auto it = source.find(name);
+            if (it == source.end())
+                return false;
+
+            data = it->second;
+        }
+
+        std::string error;
+        if (!LuaSerializer::Deserialize(L, data->data(), data->size(), &error))
+        {
+            EclipseLogger::GetInstance().LogError("Snapshot '" + name + "' cannot be decoded: " + error);
+            return false;
+        }
+
+        return true;
+    }
+}
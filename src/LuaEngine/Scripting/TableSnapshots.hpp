@@ -0,0 +1,56 @@
+#ifndef ECLIPSE_TABLE_SNAPSHOTS_HPP
+#define ECLIPSE_TABLE_SNAPSHOTS_HPP
+
+#include "EclipseIncludes.hpp"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace Eclipse
+{
+    // Load-time tables built once by the global state. They are serialized after the
+    // global state finished loading, other states decode a copy instead of running
+    // the script code that built them.
+    class TableSnapshots
+    {
+    public:
+        static TableSnapshots& GetInstance();
+
+        // Records the table at index in L to be published once the load finishes
+        static void Mark(lua_State* L, const std::string& name, int index);
+
+        // Serializes every table marked in L. A full load replaces all published snapshots,
+        // reloading a single script only replaces the ones it marked again.
+        void Publish(lua_State* L, bool fullLoad = true);
+
+        // Background reload: the staged global state publishes aside, only staged states see
+        // the result until it is committed at the swap or discarded when the reload fails
+        void PublishStaged(lua_State* L);
+        void CommitStaged();
+        void DiscardStaged();
+
+        // Pushes a copy of the snapshot, false and nothing pushed if there is none
+        bool Push(lua_State* L, const std::string& name, bool staged = false) const;
+
+    private:
+        using SnapshotMap = std::unordered_map<std::string, std::shared_ptr<const std::string>>;
+
+        static constexpr const char* MARKED_KEY = "eclipse.snapshots";
+
+        TableSnapshots() = default;
+        ~TableSnapshots() = default;
+        TableSnapshots(const TableSnapshots&) = delete;
+        TableSnapshots& operator=(const TableSnapshots&) = delete;
+
+        // Serializes and clears the tables marked in L
+        static SnapshotMap Collect(lua_State* L);
+
+        mutable std::mutex mutex;
+        SnapshotMap snapshots;
+        SnapshotMap stagedSnapshots;
+    };
+}
+
+#endif // ECLIPSE_TABLE_SNAPSHOTS_HPP
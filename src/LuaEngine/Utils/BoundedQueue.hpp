@@ -0,0 +1,71 @@
+#ifndef ECLIPSE_BOUNDED_QUEUE_HPP
+#define ECLIPSE_BOUNDED_QUEUE_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+namespace Eclipse
+{
+    // Blocking FIFO between pipeline stages. Push waits while the queue is full, which
+    // holds a fast producer back; Close wakes everyone and lets consumers drain the rest.
+    template <typename T>
+    class BoundedQueue
+    {
+    public:
+        explicit BoundedQueue(size_t queueCapacity) : capacity(queueCapacity ? queueCapacity : 1) {}
+
+        BoundedQueue(const BoundedQueue&) = delete;
+        BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+        // False if the queue was closed, the item is dropped
+        bool Push(T&& item)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            notFull.wait(lock, [this] { return closed || items.size() < capacity; });
+            if (closed)
+                return false;
+
+            items.push_back(std::move(item));
+            notEmpty.notify_one();
+            return true;
+        }
+
+        // Empty once the queue is closed and drained
+        std::optional<T> Pop()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            notEmpty.wait(lock, [this] { return closed || !items.empty(); });
+            if (items.empty())
+                return std::nullopt;
+
+            T item = std::move(items.front());
+            items.pop_front();
+            notFull.notify_one();
+            return item;
+        }
+
+        void Close()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                closed = true;
+            }
+
+            notFull.notify_all();
+            notEmpty.notify_all();
+        }
+
+    private:
+        const size_t capacity;
+        std::mutex mutex;
+        std::condition_variable notFull;
+        std::condition_variable notEmpty;
+        std::deque<T> items;
+        bool closed = false;
+    };
+}
+
+#endif // ECLIPSE_BOUNDED_QUEUE_HPP
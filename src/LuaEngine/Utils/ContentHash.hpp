@@ -0,0 +1,122 @@
+#ifndef ECLIPSE_CONTENT_HASH_HPP
+#define ECLIPSE_CONTENT_HASH_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace Eclipse
+{
+    // XXH64, used to key cached bytecode by script content. Not a cryptographic hash.
+    class ContentHash
+    {
+    public:
+        static uint64_t Compute(const void* data, size_t size, uint64_t seed = 0)
+        {
+            const uint8_t* p = static_cast<const uint8_t*>(data);
+            const uint8_t* end = p + size;
+            uint64_t hash;
+
+            if (size >= 32)
+            {
+                uint64_t v1 = seed + PRIME1 + PRIME2;
+                uint64_t v2 = seed + PRIME2;
+                uint64_t v3 = seed;
+                uint64_t v4 = seed - PRIME1;
+
+                const uint8_t* limit = end - 32;
+                do
+                {
+                    v1 = Round(v1, Read64(p));
+                    v2 = Round(v2, Read64(p + 8));
+                    v3 = Round(v3, Read64(p + 16));
+                    v4 = Round(v4, Read64(p + 24));
+                    p += 32;
+                } while (p <= limit);
+
+                hash = Rotl(v1, 1) + Rotl(v2, 7) + Rotl(v3, 12) + Rotl(v4, 18);
+                hash = MergeRound(hash, v1);
+                hash = MergeRound(hash, v2);
+                hash = MergeRound(hash, v3);
+                hash = MergeRound(hash, v4);
+            }
+            else
+            {
+                hash = seed + PRIME5;
+            }
+
+            hash += static_cast<uint64_t>(size);
+
+            while (p + 8 <= end)
+            {
+                hash ^= Round(0, Read64(p));
+                hash = Rotl(hash, 27) * PRIME1 + PRIME4;
+                p += 8;
+            }
+
+            if (p + 4 <= end)
+            {
+                hash ^= static_cast<uint64_t>(Read32(p)) * PRIME1;
+                hash = Rotl(hash, 23) * PRIME2 + PRIME3;
+                p += 4;
+            }
+
+            while (p < end)
+            {
+                hash ^= static_cast<uint64_t>(*p) * PRIME5;
+                hash = Rotl(hash, 11) * PRIME1;
+                ++p;
+            }
+
+            hash ^= hash >> 33;
+            hash *= PRIME2;
+            hash ^= hash >> 29;
+            hash *= PRIME3;
+            hash ^= hash >> 32;
+            return hash;
+        }
+
+        static uint64_t Compute(std::string_view data, uint64_t seed = 0)
+        {
+            return Compute(data.data(), data.size(), seed);
+        }
+
+    private:
+        static constexpr uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+        static constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+        static constexpr uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+        static constexpr uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+        static constexpr uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+        static uint64_t Rotl(uint64_t value, int bits) { return (value << bits) | (value >> (64 - bits)); }
+
+        static uint64_t Read64(const uint8_t* p)
+        {
+            uint64_t value;
+            std::memcpy(&value, p, sizeof(value));
+            return value;
+        }
+
+        static uint32_t Read32(const uint8_t* p)
+        {
+            uint32_t value;
+            std::memcpy(&value, p, sizeof(value));
+            return value;
+        }
+
+        static uint64_t Round(uint64_t acc, uint64_t input)
+        {
+            acc += input * PRIME2;
+            acc = Rotl(acc, 31);
+            return acc * PRIME1;
+        }
+
+        static uint64_t MergeRound(uint64_t acc, uint64_t value)
+        {
+            acc ^= Round(0, value);
+            return acc * PRIME1 + PRIME4;
+        }
+    };
+}
+
+#endif // ECLIPSE_CONTENT_HASH_HPP
@@ -0,0 +1,72 @@
+#include "FileFingerprint.hpp"
+#include "ContentHash.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+namespace Eclipse
+{
+    std::optional<FileFingerprint> FileFingerprint::Stat(const std::string& filePath)
+    {
+        FileFingerprint fingerprint;
+
+#ifndef _WIN32
+        struct stat info;
+        if (::stat(filePath.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+            return std::nullopt;
+
+#ifdef __APPLE__
+        const timespec& mtime = info.st_mtimespec;
+#else
+        const timespec& mtime = info.st_mtim;
+#endif
+        fingerprint.size = static_cast<uint64>(info.st_size);
+        fingerprint.mtimeNs = static_cast<int64>(mtime.tv_sec) * 1000000000 + mtime.tv_nsec;
+        fingerprint.inode = static_cast<uint64>(info.st_ino);
+#else
+        std::error_code ec;
+        fingerprint.size = std::filesystem::file_size(filePath, ec);
+        if (ec)
+            return std::nullopt;
+
+        auto writeTime = std::filesystem::last_write_time(filePath, ec);
+        if (ec)
+            return std::nullopt;
+
+        fingerprint.mtimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(writeTime.time_since_epoch()).count();
+#endif
+
+        return fingerprint;
+    }
+
+    std::optional<FileFingerprint> FileFingerprint::Capture(const std::string& filePath)
+    {
+        auto fingerprint = Stat(filePath);
+        if (!fingerprint)
+            return std::nullopt;
+
+        auto hash = HashFile(filePath);
+        if (!hash)
+            return std::nullopt;
+
+        fingerprint->contentHash = *hash;
+        return fingerprint;
+    }
+
+    std::optional<uint64> FileFingerprint::HashFile(const std::string& filePath)
+    {
+        std::ifstream file(filePath, std::ios::binary);
+        if (!file.is_open())
+            return std::nullopt;
+
+        std::vector<char> content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        return ContentHash::Compute(content.data(), content.size());
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef ECLIPSE_FILE_FINGERPRINT_HPP
+#define ECLIPSE_FILE_FINGERPRINT_HPP
+
+#include "EclipseIncludes.hpp"
+
+#include <optional>
+#include <string>
+
+namespace Eclipse
+{
+    // Identity of a file's content. Size, mtime and inode come from a single stat and
+    // are compared first; the content hash only settles the cases where they differ.
+    struct FileFingerprint
+    {
+        uint64 size = 0;
+        int64 mtimeNs = 0;
+        uint64 inode = 0;
+        uint64 contentHash = 0;
+
+        bool SameMetadata(const FileFingerprint& other) const
+        {
+            return size == other.size && mtimeNs == other.mtimeNs && inode == other.inode;
+        }
+
+        // Metadata only, contentHash is left at 0
+        static std::optional<FileFingerprint> Stat(const std::string& filePath);
+        // Metadata and content hash
+        static std::optional<FileFingerprint> Capture(const std::string& filePath);
+        static std::optional<uint64> HashFile(const std::string& filePath);
+    };
+}
+
+#endif // ECLIPSE_FILE_FINGERPRINT_HPP
@@ -0,0 +1,607 @@
+#include "LuaSerializer.hpp"
+#include "ObjectGuid.h"
+
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace Eclipse
+{
+    namespace
+    {
+        enum Tag : uint8
+        {
+            TAG_NIL,
+            TAG_FALSE,
+            TAG_TRUE,
+            TAG_INTEGER,
+            TAG_NUMBER,
+            TAG_STRING,
+            TAG_TABLE,
+            TAG_REF,
+            TAG_END,
+            TAG_GUID,
+            // Tables whose array part only holds numbers, packed without per-element tags
+            TAG_INTEGER_ARRAY,
+            TAG_NUMBER_ARRAY
+        };
+
+        constexpr int MAX_DEPTH = 128;
+
+        // Shorter arrays gain nothing from packing
+        constexpr size_t MIN_PACKED_ARRAY = 4;
+
+        // Buffers kept per serializing thread
+        constexpr size_t MAX_POOLED_BUFFERS = 64;
+        constexpr size_t MAX_POOLED_CAPACITY = 64 * 1024;
+
+        // Pool of the thread that serialized a buffer. The last state to decode it may run on
+        // another thread, the buffer still goes back here so pools never migrate; a pool
+        // outlives its thread until every buffer it issued is released.
+        struct BufferPool
+        {
+            std::mutex mutex;
+            std::vector<std::unique_ptr<std::string>> buffers;
+
+            std::unique_ptr<std::string> Acquire()
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (buffers.empty())
+                    return std::make_unique<std::string>();
+
+                auto buffer = std::move(buffers.back());
+                buffers.pop_back();
+                return buffer;
+            }
+
+            void Release(std::unique_ptr<std::string> buffer)
+            {
+                if (buffer->capacity() > MAX_POOLED_CAPACITY)
+                    return;
+
+                buffer->clear();
+
+                std::lock_guard<std::mutex> lock(mutex);
+                if (buffers.size() < MAX_POOLED_BUFFERS)
+                    buffers.push_back(std::move(buffer));
+            }
+        };
+
+        struct ThreadBufferPool
+        {
+            std::shared_ptr<BufferPool> pool = std::make_shared<BufferPool>();
+
+            ~ThreadBufferPool() { destroyed = true; }
+
+            static thread_local bool destroyed;
+        };
+
+        thread_local bool ThreadBufferPool::destroyed = false;
+        thread_local ThreadBufferPool threadBufferPool;
+
+        // Null while the thread is exiting
+        std::shared_ptr<BufferPool> GetBufferPool()
+        {
+            return ThreadBufferPool::destroyed ? nullptr : threadBufferPool.pool;
+        }
+
+        // Integral numbers below 2^53 are exact as doubles, pre-5.3 Lua encodes them as integers
+        constexpr double MAX_EXACT_INTEGER = 9007199254740992.0;
+
+        int AbsoluteIndex(lua_State* L, int index)
+        {
+            return index < 0 && index > LUA_REGISTRYINDEX ? lua_gettop(L) + index + 1 : index;
+        }
+
+        size_t RawLength(lua_State* L, int index)
+        {
+#if LUA_VERSION_NUM >= 502
+            return lua_rawlen(L, index);
+#else
+            return lua_objlen(L, index);
+#endif
+        }
+
+        void PushInteger(lua_State* L, int64 value)
+        {
+#if LUA_VERSION_NUM >= 503
+            lua_pushinteger(L, static_cast<lua_Integer>(value));
+#else
+            lua_pushnumber(L, static_cast<lua_Number>(value));
+#endif
+        }
+
+        class Writer
+        {
+        public:
+            Writer(lua_State* state, std::string& buffer) : L(state), out(buffer) {}
+
+            bool Write(int index, int depth)
+            {
+                index = AbsoluteIndex(L, index);
+
+                int type = lua_type(L, index);
+                switch (type)
+                {
+                    case LUA_TNIL:
+                        out.push_back(TAG_NIL);
+                        return true;
+                    case LUA_TBOOLEAN:
+                        out.push_back(lua_toboolean(L, index) ? TAG_TRUE : TAG_FALSE);
+                        return true;
+                    case LUA_TNUMBER:
+                        WriteNumber(index);
+                        return true;
+                    case LUA_TSTRING:
+                    {
+                        size_t length;
+                        const char* data = lua_tolstring(L, index, &length);
+                        out.push_back(TAG_STRING);
+                        WriteVarint(length);
+                        out.append(data, length);
+                        return true;
+                    }
+                    case LUA_TTABLE:
+                        return WriteTable(index, depth);
+                    case LUA_TUSERDATA:
+                        if (sol::stack::check<ObjectGuid>(L, index, sol::no_panic))
+                        {
+                            out.push_back(TAG_GUID);
+                            WriteVarint(sol::stack::get<ObjectGuid&>(L, index).GetRawValue());
+                            return true;
+                        }
+                        [[fallthrough]];
+                    default:
+                        error = std::string("cannot serialize a ") + lua_typename(L, type) + " value";
+                        return false;
+                }
+            }
+
+            std::string error;
+
+        private:
+            lua_State* L;
+            std::string& out;
+
+            // Tables already written and their reference number, in the order they were opened
+            std::unordered_map<const void*, uint64> tables;
+
+            void WriteVarint(uint64 value)
+            {
+                while (value >= 0x80)
+                {
+                    out.push_back(static_cast<char>(value | 0x80));
+                    value >>= 7;
+                }
+                out.push_back(static_cast<char>(value));
+            }
+
+            void WriteNumber(int index)
+            {
+#if LUA_VERSION_NUM >= 503
+                if (lua_isinteger(L, index))
+                {
+                    WriteInteger(static_cast<int64>(lua_tointeger(L, index)));
+                    return;
+                }
+#endif
+                double value = static_cast<double>(lua_tonumber(L, index));
+
+#if LUA_VERSION_NUM < 503
+                if (std::floor(value) == value && std::fabs(value) < MAX_EXACT_INTEGER)
+                {
+                    WriteInteger(static_cast<int64>(value));
+                    return;
+                }
+#endif
+                // Host byte order, the encoding never leaves the process
+                char bytes[sizeof(double)];
+                std::memcpy(bytes, &value, sizeof(double));
+                out.push_back(TAG_NUMBER);
+                out.append(bytes, sizeof(double));
+            }
+
+            void WriteInteger(int64 value)
+            {
+                out.push_back(TAG_INTEGER);
+                WriteVarint(ZigZag(value));
+            }
+
+            static uint64 ZigZag(int64 value)
+            {
+                return (static_cast<uint64>(value) << 1) ^ static_cast<uint64>(value >> 63);
+            }
+
+            bool IsIntegral(int index)
+            {
+#if LUA_VERSION_NUM >= 503
+                return lua_isinteger(L, index);
+#else
+                lua_Number value = lua_tonumber(L, index);
+                return std::floor(value) == value && std::fabs(value) < MAX_EXACT_INTEGER;
+#endif
+            }
+
+            // False if the array part holds anything but numbers, or mixes integers and floats
+            // (packing them as floats would change the subtype of the integers); nothing is written then
+            bool WritePackedArray(int index, size_t arrayCount)
+            {
+                if (arrayCount < MIN_PACKED_ARRAY)
+                    return false;
+
+                size_t integerCount = 0;
+                for (size_t i = 1; i <= arrayCount; ++i)
+                {
+                    lua_rawgeti(L, index, static_cast<int>(i));
+                    bool number = lua_type(L, -1) == LUA_TNUMBER;
+                    if (number && IsIntegral(-1))
+                        ++integerCount;
+                    lua_pop(L, 1);
+
+                    if (!number)
+                        return false;
+                }
+
+                if (integerCount != 0 && integerCount != arrayCount)
+                    return false;
+
+                bool integers = integerCount == arrayCount;
+
+                out.push_back(integers ? TAG_INTEGER_ARRAY : TAG_NUMBER_ARRAY);
+                WriteVarint(arrayCount);
+
+                if (!integers)
+                    out.reserve(out.size() + arrayCount * sizeof(double));
+
+                for (size_t i = 1; i <= arrayCount; ++i)
+                {
+                    lua_rawgeti(L, index, static_cast<int>(i));
+                    if (integers)
+                    {
+#if LUA_VERSION_NUM >= 503
+                        int64 value = static_cast<int64>(lua_tointeger(L, -1));
+#else
+                        int64 value = static_cast<int64>(lua_tonumber(L, -1));
+#endif
+                        WriteVarint(ZigZag(value));
+                    }
+                    else
+                    {
+                        double value = static_cast<double>(lua_tonumber(L, -1));
+                        char bytes[sizeof(double)];
+                        std::memcpy(bytes, &value, sizeof(double));
+                        out.append(bytes, sizeof(double));
+                    }
+                    lua_pop(L, 1);
+                }
+
+                return true;
+            }
+
+            bool IsArrayKey(int index, size_t arrayCount)
+            {
+                if (lua_type(L, index) != LUA_TNUMBER)
+                    return false;
+
+                lua_Number key = lua_tonumber(L, index);
+                return key >= 1 && key <= static_cast<lua_Number>(arrayCount) && std::floor(key) == key;
+            }
+
+            bool WriteTable(int index, int depth)
+            {
+                auto [it, inserted] = tables.try_emplace(lua_topointer(L, index), tables.size());
+                if (!inserted)
+                {
+                    out.push_back(TAG_REF);
+                    WriteVarint(it->second);
+                    return true;
+                }
+
+                if (depth >= MAX_DEPTH || !lua_checkstack(L, 3))
+                {
+                    error = "tables are nested too deeply";
+                    return false;
+                }
+
+                size_t arrayCount = RawLength(L, index);
+                if (!WritePackedArray(index, arrayCount))
+                {
+                    out.push_back(TAG_TABLE);
+                    WriteVarint(arrayCount);
+
+                    for (size_t i = 1; i <= arrayCount; ++i)
+                    {
+                        lua_rawgeti(L, index, static_cast<int>(i));
+                        bool written = Write(-1, depth + 1);
+                        lua_pop(L, 1);
+
+                        if (!written)
+                            return false;
+                    }
+                }
+
+                lua_pushnil(L);
+                while (lua_next(L, index))
+                {
+                    if (!IsArrayKey(-2, arrayCount))
+                    {
+                        if (!Write(-2, depth + 1) || !Write(-1, depth + 1))
+                        {
+                            lua_pop(L, 2);
+                            return false;
+                        }
+                    }
+
+                    lua_pop(L, 1);
+                }
+
+                out.push_back(TAG_END);
+                return true;
+            }
+        };
+
+        class Reader
+        {
+        public:
+            Reader(lua_State* state, const char* buffer, size_t length, int referenceIndex)
+                : L(state), data(reinterpret_cast<const uint8*>(buffer)), size(length), refs(referenceIndex) {}
+
+            bool Read(int depth)
+            {
+                if (pos >= size)
+                    return Fail("truncated data");
+
+                switch (data[pos++])
+                {
+                    case TAG_NIL:
+                        lua_pushnil(L);
+                        return true;
+                    case TAG_FALSE:
+                        lua_pushboolean(L, 0);
+                        return true;
+                    case TAG_TRUE:
+                        lua_pushboolean(L, 1);
+                        return true;
+                    case TAG_INTEGER:
+                    {
+                        uint64 encoded;
+                        if (!ReadVarint(encoded))
+                            return false;
+
+                        PushInteger(L, static_cast<int64>(encoded >> 1) ^ -static_cast<int64>(encoded & 1));
+                        return true;
+                    }
+                    case TAG_NUMBER:
+                    {
+                        if (size - pos < sizeof(double))
+                            return Fail("truncated number");
+
+                        double value;
+                        std::memcpy(&value, data + pos, sizeof(double));
+                        pos += sizeof(double);
+                        lua_pushnumber(L, static_cast<lua_Number>(value));
+                        return true;
+                    }
+                    case TAG_STRING:
+                    {
+                        uint64 length;
+                        if (!ReadVarint(length))
+                            return false;
+                        if (length > size - pos)
+                            return Fail("truncated string");
+
+                        lua_pushlstring(L, reinterpret_cast<const char*>(data + pos), static_cast<size_t>(length));
+                        pos += static_cast<size_t>(length);
+                        return true;
+                    }
+                    case TAG_TABLE:
+                    case TAG_INTEGER_ARRAY:
+                    case TAG_NUMBER_ARRAY:
+                        return ReadTable(data[pos - 1], depth);
+                    case TAG_GUID:
+                    {
+                        uint64 raw;
+                        if (!ReadVarint(raw))
+                            return false;
+
+                        sol::stack::push(L, ObjectGuid(raw));
+                        return true;
+                    }
+                    case TAG_REF:
+                    {
+                        uint64 reference;
+                        if (!ReadVarint(reference))
+                            return false;
+                        if (reference >= tableCount)
+                            return Fail("invalid table reference");
+
+                        lua_rawgeti(L, refs, static_cast<int>(reference + 1));
+                        return true;
+                    }
+                    default:
+                        return Fail("unknown tag");
+                }
+            }
+
+            bool AtEnd() const { return pos == size; }
+
+            std::string error;
+
+        private:
+            lua_State* L;
+            const uint8* data;
+            size_t size;
+            size_t pos = 0;
+            int refs;
+            uint64 tableCount = 0;
+
+            bool Fail(const char* reason)
+            {
+                error = reason;
+                return false;
+            }
+
+            bool ReadVarint(uint64& value)
+            {
+                value = 0;
+                for (uint32 shift = 0; shift < 64; shift += 7)
+                {
+                    if (pos >= size)
+                        return Fail("truncated varint");
+
+                    uint8 byte = data[pos++];
+                    value |= static_cast<uint64>(byte & 0x7F) << shift;
+                    if (!(byte & 0x80))
+                        return true;
+                }
+
+                return Fail("invalid varint");
+            }
+
+            bool ReadTable(uint8 tag, int depth)
+            {
+                if (depth >= MAX_DEPTH || !lua_checkstack(L, 4))
+                    return Fail("tables are nested too deeply");
+
+                uint64 arrayCount;
+                if (!ReadVarint(arrayCount))
+                    return false;
+
+                // Every element takes at least one byte, a larger count is corrupt
+                if (arrayCount > size - pos)
+                    return Fail("invalid array size");
+
+                lua_createtable(L, static_cast<int>(arrayCount), 0);
+                lua_pushvalue(L, -1);
+                lua_rawseti(L, refs, static_cast<int>(++tableCount));
+
+                if (tag == TAG_INTEGER_ARRAY)
+                {
+                    for (uint64 i = 1; i <= arrayCount; ++i)
+                    {
+                        uint64 encoded;
+                        if (!ReadVarint(encoded))
+                            return false;
+
+                        PushInteger(L, static_cast<int64>(encoded >> 1) ^ -static_cast<int64>(encoded & 1));
+                        lua_rawseti(L, -2, static_cast<int>(i));
+                    }
+                }
+                else if (tag == TAG_NUMBER_ARRAY)
+                {
+                    if (arrayCount > (size - pos) / sizeof(double))
+                        return Fail("truncated number array");
+
+                    for (uint64 i = 1; i <= arrayCount; ++i)
+                    {
+                        double value;
+                        std::memcpy(&value, data + pos, sizeof(double));
+                        pos += sizeof(double);
+
+                        lua_pushnumber(L, static_cast<lua_Number>(value));
+                        lua_rawseti(L, -2, static_cast<int>(i));
+                    }
+                }
+                else
+                {
+                    for (uint64 i = 1; i <= arrayCount; ++i)
+                    {
+                        if (!Read(depth + 1))
+                            return false;
+
+                        if (lua_isnil(L, -1))
+                            lua_pop(L, 1);
+                        else
+                            lua_rawseti(L, -2, static_cast<int>(i));
+                    }
+                }
+
+                while (true)
+                {
+                    if (pos >= size)
+                        return Fail("unterminated table");
+
+                    if (data[pos] == TAG_END)
+                    {
+                        ++pos;
+                        return true;
+                    }
+
+                    if (!Read(depth + 1) || !Read(depth + 1))
+                        return false;
+
+                    // Both would raise an error in lua_rawset
+                    if (lua_isnil(L, -2) || (lua_type(L, -2) == LUA_TNUMBER && lua_tonumber(L, -2) != lua_tonumber(L, -2)))
+                        return Fail("invalid table key");
+
+                    lua_rawset(L, -3);
+                }
+            }
+        };
+    }
+
+    bool LuaSerializer::Serialize(lua_State* L, int index, std::string& out, std::string* error)
+    {
+        size_t start = out.size();
+        int top = lua_gettop(L);
+
+        Writer writer(L, out);
+        if (writer.Write(index, 0))
+            return true;
+
+        lua_settop(L, top);
+        out.resize(start);
+        if (error)
+            *error = std::move(writer.error);
+        return false;
+    }
+
+    SerializedValue LuaSerializer::Serialize(lua_State* L, int index, std::string* error)
+    {
+        std::shared_ptr<BufferPool> pool = GetBufferPool();
+        auto buffer = pool ? pool->Acquire() : std::make_unique<std::string>();
+        if (!Serialize(L, index, *buffer, error))
+        {
+            if (pool)
+                pool->Release(std::move(buffer));
+            return nullptr;
+        }
+
+        if (!pool)
+            return SerializedValue(std::move(buffer));
+
+        return SerializedValue(buffer.release(), [pool](const std::string* released)
+        {
+            pool->Release(std::unique_ptr<std::string>(const_cast<std::string*>(released)));
+        });
+    }
+
+    bool LuaSerializer::Deserialize(lua_State* L, const char* data, size_t size, std::string* error)
+    {
+        int top = lua_gettop(L);
+        if (!lua_checkstack(L, 4))
+        {
+            if (error)
+                *error = "stack overflow";
+            return false;
+        }
+
+        // Tables in the order they were opened, for shared and cyclic references
+        lua_newtable(L);
+
+        Reader reader(L, data, size, top + 1);
+        if (reader.Read(0) && reader.AtEnd())
+        {
+            lua_remove(L, top + 1);
+            return true;
+        }
+
+        lua_settop(L, top);
+        if (error)
+            *error = reader.error.empty() ? "trailing data" : std::move(reader.error);
+        return false;
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef ECLIPSE_LUA_SERIALIZER_HPP
+#define ECLIPSE_LUA_SERIALIZER_HPP
+
+#include "EclipseIncludes.hpp"
+
+#include <memory>
+#include <string>
+
+namespace Eclipse
+{
+    // Encoded value shared by every state it is decoded in, its buffer returns to the pool
+    // of the thread that encoded it
+    using SerializedValue = std::shared_ptr<const std::string>;
+
+    // Compact binary encoding of plain Lua values, used to hand data from one lua_State
+    // to another. Supports nil, booleans, numbers, strings, ObjectGuids and tables,
+    // including shared and cyclic references; arrays of numbers are packed. Functions,
+    // threads and other userdata are rejected.
+    class LuaSerializer
+    {
+    public:
+        // Appends the value at index to out, out is left untouched on failure
+        static bool Serialize(lua_State* L, int index, std::string& out, std::string* error = nullptr);
+        // Same encoding into a pooled buffer, nullptr on failure
+        static SerializedValue Serialize(lua_State* L, int index, std::string* error = nullptr);
+
+        // Pushes the decoded value, nothing is pushed on failure
+        static bool Deserialize(lua_State* L, const char* data, size_t size, std::string* error = nullptr);
+
+    private:
+        LuaSerializer() = delete;
+    };
+}
+
+#endif // ECLIPSE_LUA_SERIALIZER_HPP
@@ -0,0 +1,78 @@
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Eclipse
+{
+    std::shared_ptr<const MappedFile> MappedFile::Open(const std::string& filePath)
+    {
+        std::shared_ptr<MappedFile> file(new MappedFile());
+
+#ifdef _WIN32
+        HANDLE handle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (handle == INVALID_HANDLE_VALUE)
+            return nullptr;
+        file->fileHandle = handle;
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(handle, &fileSize) || fileSize.QuadPart == 0)
+            return nullptr;
+
+        HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping)
+            return nullptr;
+        file->mappingHandle = mapping;
+
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!view)
+            return nullptr;
+
+        file->data = static_cast<const char*>(view);
+        file->size = static_cast<size_t>(fileSize.QuadPart);
+#else
+        int fd = ::open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return nullptr;
+
+        struct stat info;
+        if (::fstat(fd, &info) != 0 || info.st_size == 0)
+        {
+            ::close(fd);
+            return nullptr;
+        }
+
+        // The mapping keeps its own reference to the file
+        void* view = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (view == MAP_FAILED)
+            return nullptr;
+
+        file->data = static_cast<const char*>(view);
+        file->size = static_cast<size_t>(info.st_size);
+#endif
+
+        return file;
+    }
+
+    MappedFile::~MappedFile()
+    {
+#ifdef _WIN32
+        if (data)
+            UnmapViewOfFile(data);
+        if (mappingHandle)
+            CloseHandle(mappingHandle);
+        if (fileHandle)
+            CloseHandle(fileHandle);
+#else
+        if (data)
+            ::munmap(const_cast<char*>(data), size);
+#endif
+    }
+}
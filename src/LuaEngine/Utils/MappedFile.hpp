@@ -0,0 +1,35 @@
+#ifndef ECLIPSE_MAPPED_FILE_HPP
+#define ECLIPSE_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace Eclipse
+{
+    // Read-only mapping of a whole file, unmapped on destruction
+    class MappedFile
+    {
+    public:
+        static std::shared_ptr<const MappedFile> Open(const std::string& filePath);
+
+        ~MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        const char* Data() const { return data; }
+        size_t Size() const { return size; }
+
+    private:
+        MappedFile() = default;
+
+        const char* data = nullptr;
+        size_t size = 0;
+#ifdef _WIN32
+        void* fileHandle = nullptr;
+        void* mappingHandle = nullptr;
+#endif
+    };
+}
+
+#endif // ECLIPSE_MAPPED_FILE_HPP
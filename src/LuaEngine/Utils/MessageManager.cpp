@@ -1,121 +1,383 @@
 #include "MessageManager.hpp"
-#include "MapStateManager.hpp"
+#include "LuaSerializer.hpp"
+#include "EclipseConfig.hpp"
+#include "DBCStores.h"
+
+#include <algorithm>
 
 namespace Eclipse
 {
+    StateMailbox::StateMailbox() : head(&stub), tail(&stub)
+    {
+    }
+
+    StateMailbox::~StateMailbox()
+    {
+        Discard();
+    }
+
+    void StateMailbox::Link(StateMessage* message)
+    {
+        message->next.store(nullptr, std::memory_order_relaxed);
+        StateMessage* previous = head.exchange(message, std::memory_order_acq_rel);
+        previous->next.store(message, std::memory_order_release);
+    }
+
+    void StateMailbox::Push(StateMessage* message)
+    {
+        size.fetch_add(1, std::memory_order_release);
+        Link(message);
+    }
+
+    std::unique_ptr<StateMessage> StateMailbox::Pop()
+    {
+        StateMessage* first = tail;
+        StateMessage* next = first->next.load(std::memory_order_acquire);
+
+        if (first == &stub)
+        {
+            if (!next)
+                return nullptr;
+
+            tail = next;
+            first = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+
+        if (!next)
+        {
+            // A producer swapped head but has not linked its message yet
+            if (first != head.load(std::memory_order_acquire))
+                return nullptr;
+
+            // first is the last message, the stub goes behind it so first can be unlinked
+            Link(&stub);
+            next = first->next.load(std::memory_order_acquire);
+            if (!next)
+                return nullptr;
+        }
+
+        tail = next;
+        size.fetch_sub(1, std::memory_order_release);
+        return std::unique_ptr<StateMessage>(first);
+    }
+
+    void StateMailbox::Discard()
+    {
+        while (Pop())
+        {
+        }
+    }
+
     MessageManager& MessageManager::GetInstance()
     {
         static MessageManager instance;
         return instance;
     }
 
-    void MessageManager::SendMessage(int32 fromStateId, int32 toStateId, std::string messageType, sol::object data)
+    bool MessageManager::SerializePayload(const sol::object& data, SerializedValue& payload)
+    {
+        lua_State* L = data.lua_state();
+        if (!L || data.get_type() == sol::type::lua_nil)
+            return true;
+
+        std::string error;
+        data.push(L);
+        payload = LuaSerializer::Serialize(L, -1, &error);
+        lua_pop(L, 1);
+
+        if (!payload)
+            LOG_ERROR("server.eclipse", "[Eclipse]: Message data cannot be sent to another state: {}", error);
+
+        return payload != nullptr;
+    }
+
+    MessageTypeId MessageManager::InternMessageType(const std::string& name)
     {
         {
-            std::unique_lock<std::shared_mutex> lock(messageQueueMutex);
-            messageQueue[toStateId].emplace_back(fromStateId, toStateId, std::move(messageType), std::move(data));
+            std::shared_lock<std::shared_mutex> lock(messageTypesMutex);
+            auto it = messageTypeIds.find(name);
+            if (it != messageTypeIds.end())
+                return it->second;
         }
-        ProcessMessages(toStateId);
+
+        std::unique_lock<std::shared_mutex> lock(messageTypesMutex);
+        auto [it, inserted] = messageTypeIds.try_emplace(name, static_cast<MessageTypeId>(messageTypeNames.size() + 1));
+        if (inserted)
+            messageTypeNames.push_back(name);
+
+        return it->second;
+    }
+
+    std::string MessageManager::GetMessageTypeName(MessageTypeId messageType) const
+    {
+        std::shared_lock<std::shared_mutex> lock(messageTypesMutex);
+        return IsMessageTypeLocked(messageType) ? messageTypeNames[messageType - 1] : std::string();
     }
 
-    void MessageManager::BroadcastMessage(int32 fromStateId, std::string messageType, sol::object data)
+    bool MessageManager::IsMessageType(MessageTypeId messageType) const
     {
-        std::vector<int32> stateIds;
-        
+        std::shared_lock<std::shared_mutex> lock(messageTypesMutex);
+        return IsMessageTypeLocked(messageType);
+    }
+
+    bool MessageManager::IsStateId(int32 stateId)
+    {
+        return stateId == -1 || (stateId >= 0 && sMapStore.LookupEntry(static_cast<uint32>(stateId)));
+    }
+
+    bool MessageManager::Post(StateMailbox& mailbox, std::unique_ptr<StateMessage> message)
+    {
+        uint32 limit = EclipseConfig::GetInstance().GetMessageMailboxLimit();
+        size_t queued = mailbox.GetSize();
+
+        if (limit && queued >= limit)
         {
-            std::shared_lock<std::shared_mutex> lock(messageHandlersMutex);
-            stateIds.reserve(messageHandlers.size());
-            for (const auto& [stateId, handlers] : messageHandlers) {
-                if (handlers.find(messageType) != handlers.end()) {
-                    stateIds.emplace_back(stateId);
-                }
-            }
-        }
-        
-        for (int32 stateId : stateIds) {
-            SendMessage(fromStateId, stateId, messageType, data);
+            uint64 dropped = mailbox.CountDropped();
+            if (mailbox.BeginOverflow())
+                LOG_WARN("server.eclipse", "[Eclipse]: Mailbox of state {} is full ({} messages), dropping messages until it drains", message->toStateId, queued);
+            else if (dropped % limit == 0)
+                LOG_WARN("server.eclipse", "[Eclipse]: Mailbox of state {} is still full, {} messages dropped", message->toStateId, dropped);
+            return false;
         }
+
+        if (queued < limit / 2 && mailbox.EndOverflow())
+            LOG_WARN("server.eclipse", "[Eclipse]: Mailbox of state {} drained, {} messages were dropped", message->toStateId, mailbox.TakeDropped());
+
+        mailbox.Push(message.release());
+        return true;
     }
 
-    void MessageManager::RegisterMessageEvent(int32 stateId, std::string messageType, sol::function callback)
+    void MessageManager::SendMessage(int32 fromStateId, int32 toStateId, MessageTypeId messageType, sol::object data)
     {
-        if (callback.valid())
+        if (!IsStateId(toStateId))
         {
-            std::unique_lock<std::shared_mutex> lock(messageHandlersMutex);
-            auto& handlers = messageHandlers[stateId][std::move(messageType)];
-            handlers.reserve(4);
-            handlers.emplace_back(std::move(callback));
+            LOG_ERROR("server.eclipse", "[Eclipse]: Message '{}' sent to state {}, which does not exist", GetMessageTypeName(messageType), toStateId);
+            return;
         }
+
+        SerializedValue payload;
+        if (!SerializePayload(data, payload))
+            return;
+
+        Post(OpenMailbox(toStateId), std::make_unique<StateMessage>(fromStateId, toStateId, messageType, std::move(payload)));
     }
 
-    void MessageManager::ProcessMessages(int32 stateId)
+    void MessageManager::BroadcastMessage(int32 fromStateId, MessageTypeId messageType, sol::object data)
     {
-        std::vector<StateMessage> messagesToProcess;
-        
+        SubscriberList stateSubscribers;
+
         {
-            std::unique_lock<std::shared_mutex> lock(messageQueueMutex);
-            auto queueIt = messageQueue.find(stateId);
-            if (queueIt == messageQueue.end() || queueIt->second.empty())
-            {
+            std::shared_lock<std::shared_mutex> lock(subscribersMutex);
+            if (messageType >= subscribers.size() || !subscribers[messageType])
                 return;
-            }
-            messagesToProcess = std::move(queueIt->second);
-            queueIt->second.clear();
+
+            stateSubscribers = subscribers[messageType];
         }
 
-        for (const auto& message : messagesToProcess)
+        // Encoded once, each receiver decodes its own copy
+        SerializedValue payload;
+        if (!SerializePayload(data, payload))
+            return;
+
+        for (const Subscriber& subscriber : *stateSubscribers)
         {
-            DeliverMessage(message);
+            Post(*subscriber.mailbox, std::make_unique<StateMessage>(fromStateId, subscriber.stateId, messageType, payload));
         }
     }
 
-    void MessageManager::DeliverMessage(const StateMessage& message)
+    uint32 MessageManager::SendRequest(int32 fromStateId, int32 toStateId, MessageTypeId messageType, sol::object data, std::string& error)
     {
-        std::vector<sol::function> handlersToCall;
-        
+        if (!IsStateId(toStateId))
         {
-            std::shared_lock<std::shared_mutex> lock(messageHandlersMutex);
-            auto stateIt = messageHandlers.find(message.toStateId);
-            if (stateIt == messageHandlers.end())
-            {
-                return;
-            }
+            error = "no such state";
+            return 0;
+        }
 
-            auto typeIt = stateIt->second.find(message.messageType);
-            if (typeIt == stateIt->second.end())
-            {
-                return;
-            }
-            
-            handlersToCall = typeIt->second;
+        SerializedValue payload;
+        if (!SerializePayload(data, payload))
+        {
+            error = "the request data cannot be sent to another state";
+            return 0;
+        }
+
+        // 0 stands for a failed send, it is skipped when the counter wraps
+        uint32 callId = nextCallId.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (!callId)
+            callId = nextCallId.fetch_add(1, std::memory_order_relaxed) + 1;
+
+        auto message = std::make_unique<StateMessage>(fromStateId, toStateId, messageType, std::move(payload));
+        message->kind = StateMessageKind::REQUEST;
+        message->callId = callId;
+        if (!Post(OpenMailbox(toStateId), std::move(message)))
+        {
+            error = "mailbox full";
+            return 0;
+        }
+
+        return callId;
+    }
+
+    void MessageManager::SendReply(const StateMessage& request, const sol::object& result, std::string error)
+    {
+        SerializedValue payload;
+        if (error.empty() && !SerializePayload(result, payload))
+            error = "the reply cannot be sent to another state";
+
+        // A dropped reply leaves the call to its timeout
+        auto message = std::make_unique<StateMessage>(request.toStateId, request.fromStateId, request.messageType, std::move(payload));
+        message->kind = StateMessageKind::REPLY;
+        message->callId = request.callId;
+        message->error = std::move(error);
+        Post(OpenMailbox(request.fromStateId), std::move(message));
+    }
+
+    StateMailbox* MessageManager::FindMailbox(int32 stateId) const
+    {
+        std::shared_lock<std::shared_mutex> lock(mailboxesMutex);
+        auto it = mailboxes.find(stateId);
+        return it != mailboxes.end() ? it->second.get() : nullptr;
+    }
+
+    StateMailbox& MessageManager::OpenMailbox(int32 stateId)
+    {
+        if (StateMailbox* mailbox = FindMailbox(stateId))
+            return *mailbox;
+
+        std::unique_lock<std::shared_mutex> lock(mailboxesMutex);
+        auto& mailbox = mailboxes[stateId];
+        if (!mailbox)
+            mailbox = std::make_unique<StateMailbox>();
+
+        return *mailbox;
+    }
+
+    size_t MessageManager::GetPendingMessageCount(int32 stateId) const
+    {
+        StateMailbox* mailbox = FindMailbox(stateId);
+        return mailbox ? mailbox->GetSize() : 0;
+    }
+
+    void MessageManager::Subscribe(int32 stateId, MessageTypeId messageType)
+    {
+        StateMailbox& mailbox = OpenMailbox(stateId);
+
+        std::unique_lock<std::shared_mutex> lock(subscribersMutex);
+        if (messageType >= subscribers.size())
+            subscribers.resize(messageType + 1);
+
+        SubscriberList& current = subscribers[messageType];
+        if (current && std::any_of(current->begin(), current->end(), [stateId](const Subscriber& subscriber) { return subscriber.stateId == stateId; }))
+            return;
+
+        auto updated = current ? std::make_shared<std::vector<Subscriber>>(*current) : std::make_shared<std::vector<Subscriber>>();
+        updated->push_back({ stateId, &mailbox });
+        current = std::move(updated);
+    }
+
+    void MessageManager::Unsubscribe(int32 stateId, MessageTypeId messageType)
+    {
+        std::unique_lock<std::shared_mutex> lock(subscribersMutex);
+        if (messageType >= subscribers.size())
+            return;
+
+        SubscriberList& current = subscribers[messageType];
+        if (!current || std::none_of(current->begin(), current->end(), [stateId](const Subscriber& subscriber) { return subscriber.stateId == stateId; }))
+            return;
+
+        auto updated = std::make_shared<std::vector<Subscriber>>(*current);
+        std::erase_if(*updated, [stateId](const Subscriber& subscriber) { return subscriber.stateId == stateId; });
+        current = updated->empty() ? nullptr : SubscriberList(std::move(updated));
+    }
+
+    void MessageManager::UnsubscribeAll(int32 stateId)
+    {
+        std::unique_lock<std::shared_mutex> lock(subscribersMutex);
+        for (SubscriberList& current : subscribers)
+        {
+            if (!current || std::none_of(current->begin(), current->end(), [stateId](const Subscriber& subscriber) { return subscriber.stateId == stateId; }))
+                continue;
+
+            auto updated = std::make_shared<std::vector<Subscriber>>(*current);
+            std::erase_if(*updated, [stateId](const Subscriber& subscriber) { return subscriber.stateId == stateId; });
+            current = updated->empty() ? nullptr : SubscriberList(std::move(updated));
+        }
+    }
+
+    bool MessageManager::DecodePayload(sol::state& state, const StateMessage& message, sol::object& data)
+    {
+        data = sol::lua_nil;
+        if (!message.payload)
+            return true;
+
+        lua_State* L = state.lua_state();
+        std::string error;
+        if (!LuaSerializer::Deserialize(L, message.payload->data(), message.payload->size(), &error))
+        {
+            LOG_ERROR("server.eclipse", "[Eclipse]: Cannot decode message '{}': {}",
+                GetInstance().GetMessageTypeName(message.messageType), error);
+            return false;
+        }
+
+        data = sol::stack::pop<sol::object>(L);
+        return true;
+    }
+
+    void MessageManager::DeliverMessage(sol::state& state, const MessageHandlerTable& handlers, const StateMessage& message)
+    {
+        bool request = message.kind == StateMessageKind::REQUEST;
+
+        if (message.messageType >= handlers.size() || handlers[message.messageType].empty())
+        {
+            // The caller would otherwise wait for its timeout
+            if (request)
+                GetInstance().SendReply(message, sol::lua_nil, "no handler for '" + GetInstance().GetMessageTypeName(message.messageType) + "'");
+            return;
+        }
+
+        sol::object data;
+        if (!DecodePayload(state, message, data))
+        {
+            if (request)
+                GetInstance().SendReply(message, sol::lua_nil, "the request data is corrupt");
+            return;
         }
 
-        for (auto& handler : handlersToCall)
+        sol::object reply = sol::lua_nil;
+        std::string replyError;
+
+        for (const auto& handler : handlers[message.messageType])
         {
             try
             {
-                if (handler.valid())
+                if (handler.callback.valid())
                 {
-                    handler(message.fromStateId, message.data);
+                    sol::protected_function_result result = handler.callback(message.fromStateId, data);
+                    if (!result.valid())
+                    {
+                        sol::error error = result;
+                        LOG_ERROR("server.eclipse", "[Eclipse]: Error in message handler: {}", error.what());
+                        // The caller gets the message, the traceback stays in this state's log
+                        if (replyError.empty())
+                        {
+                            std::string_view what = error.what();
+                            replyError = what.substr(0, what.find('\n'));
+                        }
+                    }
+                    else if (request && reply.get_type() == sol::type::lua_nil)
+                        reply = result.get<sol::object>();
                 }
             }
             catch (const std::exception& e)
             {
                 LOG_ERROR("server.eclipse", "[Eclipse]: Error in message handler: {}", e.what());
+                if (replyError.empty())
+                    replyError = e.what();
             }
         }
-    }
 
-    void MessageManager::ClearStateHandlers(int32 stateId)
-    {
-        {
-            std::unique_lock<std::shared_mutex> lock(messageHandlersMutex);
-            messageHandlers.erase(stateId);
-        }
-        {
-            std::unique_lock<std::shared_mutex> lock(messageQueueMutex);
-            messageQueue.erase(stateId);
-        }
+        // A handler that answered wins over one that failed
+        if (request)
+            GetInstance().SendReply(message, reply, reply.get_type() == sol::type::lua_nil ? std::move(replyError) : std::string());
     }
-
-}
\ No newline at end of file
+}
@@ -2,24 +2,98 @@
 #define ECLIPSE_MESSAGE_MANAGER_HPP
 
 #include "EclipseIncludes.hpp"
+#include "LuaSerializer.hpp"
 
+#include <atomic>
+#include <memory>
 #include <unordered_map>
 #include <vector>
-#include <functional>
 #include <string>
 #include <shared_mutex>
 
 namespace Eclipse
 {
+    // Message types are interned once into small dense ids, 0 is never a valid type
+    using MessageTypeId = uint32;
+
+    enum class StateMessageKind : uint8
+    {
+        MESSAGE = 0,
+        REQUEST,    // the handlers' result is sent back as a REPLY with the same call id
+        REPLY
+    };
+
+    // Payloads are serialized on send: a message outlives the sender's call and is
+    // released on the receiving state's thread, it cannot hold sender references.
+    // Every receiver of a broadcast shares the same payload, nullptr stands for nil.
     struct StateMessage
     {
-        int32 fromStateId;
-        int32 toStateId;
-        std::string messageType;
-        sol::object data;
+        int32 fromStateId = 0;
+        int32 toStateId = 0;
+        MessageTypeId messageType = 0;
+        SerializedValue payload;
+
+        StateMessageKind kind = StateMessageKind::MESSAGE;
+        uint32 callId = 0;
+        std::string error;  // failed REPLY
+
+        std::atomic<StateMessage*> next{ nullptr };
+
+        StateMessage() = default;
+        StateMessage(int32 from, int32 to, MessageTypeId type, SerializedValue data)
+            : fromStateId(from), toStateId(to), messageType(type), payload(std::move(data)) {}
+    };
+
+    struct MessageHandler
+    {
+        sol::protected_function callback;
+        uint32 chunkId;
 
-        StateMessage(int32 from, int32 to, std::string type, sol::object obj)
-            : fromStateId(from), toStateId(to), messageType(std::move(type)), data(std::move(obj)) {}
+        MessageHandler(sol::function fn, uint32 chunk) : callback(std::move(fn)), chunkId(chunk) {}
+    };
+
+    // Handlers of one state indexed by message type, owned by that state and only used on its thread
+    using MessageHandlerTable = std::vector<std::vector<MessageHandler>>;
+
+    // Intrusive multi-producer single-consumer queue. Any thread may push without
+    // locking, only the thread updating the owning state pops.
+    class StateMailbox
+    {
+    public:
+        StateMailbox();
+        ~StateMailbox();
+
+        StateMailbox(const StateMailbox&) = delete;
+        StateMailbox& operator=(const StateMailbox&) = delete;
+
+        // Takes ownership of the message
+        void Push(StateMessage* message);
+
+        // Owner thread only, nullptr when empty or while a push is half done
+        std::unique_ptr<StateMessage> Pop();
+
+        size_t GetSize() const { return size.load(std::memory_order_acquire); }
+        bool IsEmpty() const { return GetSize() == 0; }
+
+        // Owner thread only
+        void Discard();
+
+        // Senders drop messages while the mailbox is full, true for the one that changed the state
+        bool BeginOverflow() { return !overflowing.exchange(true, std::memory_order_relaxed); }
+        bool EndOverflow() { return overflowing.load(std::memory_order_relaxed) && overflowing.exchange(false, std::memory_order_relaxed); }
+        // Messages dropped since the last EndOverflow
+        uint64 CountDropped() { return dropped.fetch_add(1, std::memory_order_relaxed) + 1; }
+        uint64 TakeDropped() { return dropped.exchange(0, std::memory_order_relaxed); }
+
+    private:
+        void Link(StateMessage* message);
+
+        std::atomic<StateMessage*> head;
+        StateMessage* tail;
+        StateMessage stub;
+        std::atomic<size_t> size{ 0 };
+        std::atomic<bool> overflowing{ false };
+        std::atomic<uint64> dropped{ 0 };
     };
 
     class MessageManager
@@ -27,11 +101,39 @@ namespace Eclipse
     public:
         static MessageManager& GetInstance();
 
-        void SendMessage(int32 fromStateId, int32 toStateId, std::string messageType, sol::object data);
-        void BroadcastMessage(int32 fromStateId, std::string messageType, sol::object data);
-        void RegisterMessageEvent(int32 stateId, std::string messageType, sol::function callback);
-        void ProcessMessages(int32 stateId);
-        void ClearStateHandlers(int32 stateId);
+        // Same name, same id in every state for the lifetime of the process
+        MessageTypeId InternMessageType(const std::string& name);
+        std::string GetMessageTypeName(MessageTypeId messageType) const;
+        bool IsMessageType(MessageTypeId messageType) const;
+
+        // -1 or a map id, messages to any other id are refused instead of waiting forever
+        static bool IsStateId(int32 stateId);
+
+        void SendMessage(int32 fromStateId, int32 toStateId, MessageTypeId messageType, sol::object data);
+        // Publishes to every state subscribed to the type, the data is encoded once and
+        // every mailbox receives the same payload
+        void BroadcastMessage(int32 fromStateId, MessageTypeId messageType, sol::object data);
+
+        // Call id the reply will carry, 0 with the reason in error if nothing was sent
+        uint32 SendRequest(int32 fromStateId, int32 toStateId, MessageTypeId messageType, sol::object data, std::string& error);
+
+        // Created with the state, kept while it is unloaded so messages wait for it
+        StateMailbox& OpenMailbox(int32 stateId);
+        bool HasPendingMessages(int32 stateId) const { return GetPendingMessageCount(stateId) != 0; }
+        size_t GetPendingMessageCount(int32 stateId) const;
+
+        // Broadcast routing, kept by each state for the types it has handlers for
+        void Subscribe(int32 stateId, MessageTypeId messageType);
+        void Unsubscribe(int32 stateId, MessageTypeId messageType);
+        void UnsubscribeAll(int32 stateId);
+
+        // Runs the handlers of one message in the receiving state, the handlers must not
+        // be added or removed until it returns. A REQUEST is answered with the first
+        // value returned by a handler.
+        static void DeliverMessage(sol::state& state, const MessageHandlerTable& handlers, const StateMessage& message);
+
+        // Payload of the message in the receiving state, false if it is corrupt
+        static bool DecodePayload(sol::state& state, const StateMessage& message, sol::object& data);
 
     private:
         MessageManager() = default;
@@ -39,16 +141,38 @@ namespace Eclipse
         MessageManager(const MessageManager&) = delete;
         MessageManager& operator=(const MessageManager&) = delete;
 
-        // Message queue: stateId -> vector of messages
-        std::unordered_map<int32, std::vector<StateMessage>> messageQueue;
-        mutable std::shared_mutex messageQueueMutex;
+        // Serialized data, false if it holds values that cannot leave the state
+        static bool SerializePayload(const sol::object& data, SerializedValue& payload);
+
+        // Mailboxes are only added, senders share the lock and never wait on each other
+        std::unordered_map<int32, std::unique_ptr<StateMailbox>> mailboxes;
+        mutable std::shared_mutex mailboxesMutex;
+
+        std::unordered_map<std::string, MessageTypeId> messageTypeIds;
+        std::vector<std::string> messageTypeNames;
+        mutable std::shared_mutex messageTypesMutex;
+
+        // States subscribed to each message type, indexed by id
+        struct Subscriber
+        {
+            int32 stateId;
+            StateMailbox* mailbox;
+        };
+        using SubscriberList = std::shared_ptr<const std::vector<Subscriber>>;
+
+        // Subscribers of each message type indexed by id. Lists are replaced, never
+        // modified, a publisher walks its snapshot without holding the lock.
+        std::vector<SubscriberList> subscribers;
+        mutable std::shared_mutex subscribersMutex;
 
-        // Event handlers: stateId -> messageType -> vector of callbacks
-        std::unordered_map<int32, std::unordered_map<std::string, std::vector<sol::function>>> messageHandlers;
-        mutable std::shared_mutex messageHandlersMutex;
+        std::atomic<uint32> nextCallId{ 0 };
 
-        void DeliverMessage(const StateMessage& message);
+        StateMailbox* FindMailbox(int32 stateId) const;
+        // Queues the message unless the mailbox is at Eclipse.Messages.MailboxLimit
+        static bool Post(StateMailbox& mailbox, std::unique_ptr<StateMessage> message);
+        void SendReply(const StateMessage& request, const sol::object& result, std::string error);
+        bool IsMessageTypeLocked(MessageTypeId messageType) const { return messageType && messageType <= messageTypeNames.size(); }
     };
 }
 
-#endif // ECLIPSE_MESSAGE_MANAGER_HPP
\ No newline at end of file
+#endif // ECLIPSE_MESSAGE_MANAGER_HPP
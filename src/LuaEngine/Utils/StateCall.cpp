@@ -0,0 +1,92 @@
+#include "StateCall.hpp"
+#include "ScriptLoader.hpp"
+
+namespace Eclipse
+{
+    void StateCall::Then(sol::function callback)
+    {
+        if (!callback.valid())
+            return;
+
+        // Held through the main thread, the callback may come from a coroutine that is gone when it runs
+        callback.push(mainThread);
+        Continuation continuation{ sol::protected_function(mainThread, -1), sol::thread() };
+        lua_pop(mainThread, 1);
+
+        if (done)
+            Run(continuation);
+        else
+            continuations.push_back(std::move(continuation));
+    }
+
+    void StateCall::Await(lua_State* coroutine)
+    {
+        // Referenced from the main thread, the coroutine stack is off limits while it is suspended
+        lua_pushthread(coroutine);
+        lua_xmove(coroutine, mainThread, 1);
+        continuations.push_back({ sol::protected_function(), sol::thread(mainThread, -1) });
+        lua_pop(mainThread, 1);
+    }
+
+    void StateCall::Resolve(sol::object result, sol::object failure)
+    {
+        if (done)
+            return;
+
+        done = true;
+        value = std::move(result);
+        error = std::move(failure);
+
+        // A continuation may add others through Then, they run immediately
+        std::vector<Continuation> pending = std::move(continuations);
+        continuations.clear();
+
+        for (auto& continuation : pending)
+        {
+            Run(continuation);
+        }
+    }
+
+    void StateCall::Cancel()
+    {
+        done = true;
+        continuations.clear();
+        value = sol::object();
+        error = sol::object();
+    }
+
+    void StateCall::Run(Continuation& continuation)
+    {
+        try
+        {
+            if (continuation.callback.valid())
+            {
+                sol::protected_function_result result = continuation.callback(value, error);
+                if (!result.valid())
+                {
+                    sol::error failure = result;
+                    LOG_ERROR("server.eclipse", "[Eclipse]: Error in state call continuation: {}", failure.what());
+                }
+                return;
+            }
+
+            // coroutine.resume reports errors instead of raising them, the awaiting script gets them logged
+            sol::state_view lua(mainThread);
+            sol::function resume = lua["coroutine"]["resume"];
+            std::tuple<bool, sol::object> resumed = resume(continuation.coroutine, value, error);
+
+            if (!std::get<0>(resumed))
+            {
+                // The dead coroutine keeps its stack, stripped frames are resolved from it
+                sol::object message = std::get<1>(resumed);
+                LOG_ERROR("server.eclipse", "[Eclipse]: Error in coroutine awaiting a state call: {}",
+                    ScriptLoader::DescribeError(continuation.coroutine.thread_state(),
+                        message.is<std::string>() ? message.as<std::string>() : std::string("unknown error")));
+            }
+        }
+        catch (const std::exception& e)
+        {
+            LOG_ERROR("server.eclipse", "[Eclipse]: Error in state call continuation: {}", e.what());
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef ECLIPSE_STATE_CALL_HPP
+#define ECLIPSE_STATE_CALL_HPP
+
+#include "EclipseIncludes.hpp"
+
+#include <chrono>
+#include <vector>
+
+namespace Eclipse
+{
+    // Request made by CallState, resolved on the calling state's update once the reply
+    // arrives or the call times out. Only used on the thread updating that state.
+    class StateCall
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        // L is the main thread of the calling state
+        StateCall(lua_State* L, uint32 callId, Clock::time_point expiry) : mainThread(L), id(callId), deadline(expiry) {}
+
+        uint32 GetId() const { return id; }
+        Clock::time_point GetDeadline() const { return deadline; }
+        bool IsDone() const { return done; }
+        const sol::object& GetValue() const { return value; }
+        const sol::object& GetError() const { return error; }
+
+        // Called with (value, error) once done, right away if it already is
+        void Then(sol::function callback);
+
+        // Resumes the coroutine with (value, error) once done, it must yield right after
+        void Await(lua_State* coroutine);
+
+        // Only the first result counts, continuations are released once they ran
+        void Resolve(sol::object result, sol::object failure);
+
+        // Releases the continuations without running them, their state is going away
+        void Cancel();
+
+    private:
+        struct Continuation
+        {
+            sol::protected_function callback;
+            sol::thread coroutine;
+        };
+
+        lua_State* mainThread;
+        uint32 id;
+        Clock::time_point deadline;
+        bool done = false;
+        sol::object value;
+        sol::object error;
+        std::vector<Continuation> continuations;
+
+        void Run(Continuation& continuation);
+    };
+}
+
+#endif // ECLIPSE_STATE_CALL_HPP